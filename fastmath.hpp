@@ -0,0 +1,96 @@
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Float kernels for the transport hot path. Define PT_EXACT_MATH (make FASTMATH=0)
+// to route every kernel through <cmath>, which is what fastmathcheck.hpp compares against.
+//
+// FastLog:    positive normal floats, |rel. error| < 2e-7, zero gives -inf
+// FastSinCos: |x| < 100, |abs. error| < 1.2e-7
+
+constexpr float fastLn2Hi = 0.693359375f;
+constexpr float fastLn2Lo = -2.12194440e-4f;
+constexpr float fastSqrtHalf = 0.70710678f;
+constexpr float fastTwoOverPi = 0.63661977f;
+constexpr float fastPiOver2Hi = 1.5707963705062866f;
+constexpr float fastPiOver2Lo = -4.3711388e-8f;
+
+
+inline float FastLog (const float x)
+{
+#ifdef PT_EXACT_MATH
+    return std::log (x);
+#else
+    const std::uint32_t bits = std::bit_cast<std::uint32_t> (x);
+    float e = static_cast<float> (static_cast<int> (bits >> 23) - 126);
+    float m = std::bit_cast<float> ((bits & 0x007fffffu) | 0x3f000000u); // mantissa in [0.5, 1)
+
+    const bool small = m < fastSqrtHalf;
+    e = small ? e - 1.0f : e;
+    m = small ? m + m - 1.0f : m - 1.0f;
+
+    const float z = m * m;
+    float p = 7.0376836292e-2f;
+    p = p * m - 1.1514610310e-1f;
+    p = p * m + 1.1676998740e-1f;
+    p = p * m - 1.2420140846e-1f;
+    p = p * m + 1.4249322787e-1f;
+    p = p * m - 1.6668057665e-1f;
+    p = p * m + 2.0000714765e-1f;
+    p = p * m - 2.4999993993e-1f;
+    p = p * m + 3.3333331174e-1f;
+
+    const float y = p * m * z + e * fastLn2Lo - 0.5f * z;
+    const float result = m + y + e * fastLn2Hi;
+    return x > 0.0f ? result : -INFINITY;
+#endif
+}
+
+inline void FastSinCos (const float x, float& sinOut, float& cosOut)
+{
+#ifdef PT_EXACT_MATH
+    sinOut = std::sin (x);
+    cosOut = std::cos (x);
+#else
+    // reduce to r in [-pi/4, pi/4] and quadrant j
+    const float j = std::nearbyint (x * fastTwoOverPi);
+    const float r = (x - j * fastPiOver2Hi) - j * fastPiOver2Lo;
+    const float z = r * r;
+
+    const float s = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+    const float c = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+
+    const int quadrant = static_cast<int> (j) & 3;
+    const float swappedSin = (quadrant & 1) ? c : s;
+    const float swappedCos = (quadrant & 1) ? s : c;
+    sinOut = (quadrant & 2) ? -swappedSin : swappedSin;
+    cosOut = ((quadrant + 1) & 2) ? -swappedCos : swappedCos;
+#endif
+}
+
+// sin(theta) for theta in [0, pi] from cos(theta), avoids the acos/sin round trip
+inline float SinFromCos (const float cosTheta)
+{
+    const float s = 1.0f - cosTheta * cosTheta;
+    return std::sqrt (s > 0.0f ? s : 0.0f);
+}
+
+
+// Batch forms, written so the compiler vectorizes them with -O3 -march=native
+inline void FastLogBatch (const float* __restrict in, float* __restrict out, const std::size_t n)
+{
+#pragma GCC ivdep
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = FastLog (in[i]);
+    }
+}
+
+inline void FastSinCosBatch (const float* __restrict in, float* __restrict sinOut, float* __restrict cosOut, const std::size_t n)
+{
+#pragma GCC ivdep
+    for (std::size_t i = 0; i < n; ++i) {
+        FastSinCos (in[i], sinOut[i], cosOut[i]);
+    }
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "fastmathcheck.hpp"
+#include "fastmath.hpp"
+#include "geometry.hpp"
+
+
+FastMathAccuracy CheckFastMathAccuracy (const std::size_t numSamples, const std::uint32_t seed)
+{
+    FastMathAccuracy accuracy {0.0f, 0.0f, 0.0f, {}, {}};
+
+    // Kernel errors against <cmath> on a dense sweep of the ranges used in transport
+    constexpr std::size_t sweep = 1 << 20;
+    std::vector<float> in (sweep);
+    std::vector<float> out (sweep);
+    std::vector<float> outCos (sweep);
+
+    for (std::size_t i = 0; i < sweep; ++i) {
+        in[i] = std::ldexp (1.0f + static_cast<float> (i % 4096) / 4096.0f, -static_cast<int> (i / 4096) % 40);
+    }
+    FastLogBatch (in.data (), out.data (), sweep);
+    for (std::size_t i = 0; i < sweep; ++i) {
+        const float exact = std::log (in[i]);
+        const float err = exact == 0.0f ? std::abs (out[i]) : std::abs ((out[i] - exact) / exact);
+        accuracy.logMaxRelError = std::max (accuracy.logMaxRelError, err);
+    }
+
+    for (std::size_t i = 0; i < sweep; ++i) {
+        in[i] = -2 * myMPI + 4 * myMPI * static_cast<float> (i) / sweep;
+    }
+    FastSinCosBatch (in.data (), out.data (), outCos.data (), sweep);
+    for (std::size_t i = 0; i < sweep; ++i) {
+        accuracy.sinMaxAbsError = std::max (accuracy.sinMaxAbsError, std::abs (out[i] - std::sin (in[i])));
+        accuracy.cosMaxAbsError = std::max (accuracy.cosMaxAbsError, std::abs (outCos[i] - std::cos (in[i])));
+    }
+
+    // Sampled distributions, fast and exact paths draw from independent streams
+    std::mt19937 fastGenerator (seed);
+    std::mt19937 exactGenerator (seed + 1);
+    std::uniform_real_distribution<float> randomNumber (0.0f, 1.0f);
+    auto getFast = [&fastGenerator, &randomNumber]() { return randomNumber (fastGenerator); };
+    auto getExact = [&exactGenerator, &randomNumber]() { return randomNumber (exactGenerator); };
+
+    std::vector<float> fastSamples;
+    std::vector<float> exactSamples;
+    fastSamples.reserve (numSamples);
+    exactSamples.reserve (numSamples);
+    for (std::size_t i = 0; i < numSamples; ++i) {
+        fastSamples.push_back (-FastLog (getFast ()));
+        exactSamples.push_back (-std::log (getExact ()));
+    }
+    accuracy.freePath = CompareHistograms (CreateHistogram (fastSamples, 0.0, 10.0, 200), CreateHistogram (exactSamples, 0.0, 10.0, 200));
+
+    const float alpha = 0.5f;
+    fastSamples.clear ();
+    exactSamples.clear ();
+    for (std::size_t i = 0; i < numSamples; ++i) {
+        const Vector fast = GetIsotropicDirectionInAngle (alpha, getFast);
+        fastSamples.push_back (fast.x);
+
+        const float nz = std::cos (alpha) + (1 - std::cos (alpha)) * getExact ();
+        const float theta = std::acos (nz);
+        const float beta = 2 * myMPI * getExact ();
+        exactSamples.push_back (std::sin (theta) * std::cos (beta));
+    }
+    accuracy.direction = CompareHistograms (CreateHistogram (fastSamples, -1.0, 1.0, 200), CreateHistogram (exactSamples, -1.0, 1.0, 200));
+
+    return accuracy;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "utility.hpp"
+
+
+// Accuracy of the fastmath.hpp kernels against <cmath>, run with --check-fastmath
+struct FastMathAccuracy {
+    float logMaxRelError;
+    float sinMaxAbsError;
+    float cosMaxAbsError;
+    ChiSquareResult freePath; // fast vs. exact sampled free paths
+    ChiSquareResult direction; // fast vs. exact isotropic direction components
+};
+
+FastMathAccuracy CheckFastMathAccuracy (const std::size_t numSamples, const std::uint32_t seed);
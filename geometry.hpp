@@ -1,7 +1,10 @@
 #pragma once
 #include <cmath>
 #include <concepts>
+#include <cstddef>
 #include <utility>
+#include <algorithm>
+#include "fastmath.hpp"
 
 template<typename T>
 concept RandomNumberGenerator = requires(T t) {
@@ -35,10 +38,39 @@ const Vector GetIsotropicDirectionMarsaglia (GEN& generateRandomNumber)
 template<RandomNumberGenerator GEN>
 const Vector GetIsotropicDirectionInAngle (const float alpha, GEN& generateRandomNumber)
 {
-    const float nz = std::cos (alpha) + (1 - std::cos (alpha)) * generateRandomNumber (); // cos(theta)
-    const float theta = std::acos (nz); // polar angle
+    const float cosAlpha = std::cos (alpha);
+    const float nz = cosAlpha + (1 - cosAlpha) * generateRandomNumber (); // cos(theta)
+    const float rho = SinFromCos (nz); // sin(theta)
     const float beta = 2 * myMPI * generateRandomNumber (); // azimuthal angle
-    return  {std::sin (theta) * std::cos (beta), std::sin (theta) * std::sin (beta), nz};
+    float sinBeta;
+    float cosBeta;
+    FastSinCos (beta, sinBeta, cosBeta);
+    return  {rho * cosBeta, rho * sinBeta, nz};
+}
+
+// Fills n directions at once so the sin/cos pairs go through the batch kernel
+template<RandomNumberGenerator GEN>
+void GetIsotropicDirectionsInAngle (const float alpha, GEN& generateRandomNumber, Vector* directions, const std::size_t n)
+{
+    constexpr std::size_t block = 256;
+    float nz[block];
+    float beta[block];
+    float sinBeta[block];
+    float cosBeta[block];
+
+    const float cosAlpha = std::cos (alpha);
+    for (std::size_t start = 0; start < n; start += block) {
+        const std::size_t count = std::min (block, n - start);
+        for (std::size_t i = 0; i < count; ++i) {
+            nz[i] = cosAlpha + (1 - cosAlpha) * generateRandomNumber ();
+            beta[i] = 2 * myMPI * generateRandomNumber ();
+        }
+        FastSinCosBatch (beta, sinBeta, cosBeta, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            const float rho = SinFromCos (nz[i]);
+            directions[start + i] = {rho * cosBeta[i], rho * sinBeta[i], nz[i]};
+        }
+    }
 }
 
 
@@ -1,5 +1,4 @@
 #pragma once
-#include <mutex>
 #include <vector>
 #include <map>
 #include <atomic>
@@ -10,10 +9,14 @@
 #include <random>
 #include "geometry.hpp"
 #include "crosssections.hpp"
+#include "listmode.hpp"
 
+// Returns the energy deposited by this photon and the annihilation photons it creates.
+// listMode may be null, otherwise every tallied track is also written as a list-mode record
 template<RandomNumberGenerator GEN>
-void TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  direction,const float energy_in, const std::map<float, InteractionData>& corssSections, std::vector<float>&  results, std::mutex& results_mutex,const float R, const float H);
+float TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  direction,const float energy_in, const std::map<float, InteractionData>& corssSections, std::vector<float>&  results,const float R, const float H, ListModeBuffer* listMode);
 
+// Returns the cosine of the scattering angle and the scattered photon energy
 template<RandomNumberGenerator GEN>
 std::pair<float, float> PhotonAngleAndEnergy (GEN& getRandomNumber, float energy_in);
 
@@ -23,19 +26,22 @@ std::pair<Vector, float> ComptonScatter (GEN& getRandomNumber, const Vector& dir
 
 
 template<RandomNumberGenerator GEN>
-void PairProduction (GEN& getRandomNumber, const Vector& position, const Vector&  direction,const float energy_in, const std::map<float, InteractionData>& crossSections, std::vector<float>&  results, std::mutex& results_mutex,const float R, const float H);
+float PairProduction (GEN& getRandomNumber, const Vector& position, const Vector&  direction,const float energy_in, const std::map<float, InteractionData>& crossSections, std::vector<float>&  results,const float R, const float H, ListModeBuffer* listMode);
 
 
 
 template<RandomNumberGenerator GEN>
-void TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  direction,const float energy_in, const std::map<float, InteractionData>& corssSections, std::vector<float>&  results, std::mutex& results_mutex,const float R, const float H)
+float TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  direction,const float energy_in, const std::map<float, InteractionData>& corssSections, std::vector<float>&  results,const float R, const float H, ListModeBuffer* listMode)
 {
     Vector currenctPosition = position;
     Vector currentDirection = direction;
     float energy = energy_in;
     float energyDeposit = 0.0f;
+    float annihilationDeposit = 0.0f;
 
     bool isPhotonAlive = true;
+    std::uint16_t numScatters = 0;
+    Vector firstInteraction = {0.0f, 0.0f, 0.0f};
     float distanceTravelled = 0.0f;
     float distanceToCylinder = 0.0f;
 
@@ -53,7 +59,7 @@ void TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  d
 
     while (isPhotonAlive) {
         float rand1 = getRandomNumber ();
-        distanceTravelled = -std::log (rand1) / sigma; 
+        distanceTravelled = -FastLog (rand1) / sigma; 
         distanceToCylinder = GetDistanceToCylinderIn (currenctPosition, currentDirection, R, H / 2.0f, -H /  2.0f); // Get the distance to the cylinder
         if (distanceToCylinder < distanceTravelled) {
             isPhotonAlive = false; // exiits cylinder
@@ -62,6 +68,9 @@ void TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  d
         currenctPosition.x += currentDirection.x * distanceTravelled;
         currenctPosition.y += currentDirection.y * distanceTravelled;
         currenctPosition.z += currentDirection.z * distanceTravelled;
+        if (numScatters == 0) {
+            firstInteraction = currenctPosition;
+        }
 
         float rand = getRandomNumber ();
         std::pair<Vector, float> res = {Vector{0.0f, 0.0f, 0.0f}, 0.0f};
@@ -74,6 +83,7 @@ void TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  d
                         currentDirection = res.first; // Update direction after scattering
                         energyDeposit = energy - res.second; // Energy deposited in the material
                         energy = res.second;
+                        numScatters++;
                         currentCrossSection = getCrossSectionsAtEnergy (corssSections, energy);
                         sigma = currentCrossSection.incoherentScatter + currentCrossSection.photoelAbsorb + currentCrossSection.pairProd; // Total cross-section
                         interactionList = {
@@ -90,7 +100,7 @@ void TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  d
                     case 3: // Pair production
                         energyDeposit += 1.022; // Energy deposited in the material
                         isPhotonAlive = false; // Photon is absorbed
-                        PairProduction (getRandomNumber, currenctPosition, corssSections, results, results_mutex, R, H); // Pair production
+                        annihilationDeposit = PairProduction (getRandomNumber, currenctPosition, corssSections, results, R, H, listMode); // Pair production
                         break;
                 }
                 break;
@@ -98,14 +108,17 @@ void TrackPhoton (GEN& getRandomNumber, const Vector& position, const Vector&  d
         }
     }
     //std::cout << "fianlly here" << energyDeposit << " MeV" << std::endl;
-    std::lock_guard<std::mutex> lock (results_mutex);
+    if (energyDeposit > 0.0f && listMode) {
+        const Vector& sourceDir = listMode->sourceDirection;
+        listMode->Push ({energyDeposit, firstInteraction.x, firstInteraction.y, firstInteraction.z,
+                         sourceDir.x, sourceDir.y, sourceDir.z, numScatters, listMode->track, listMode->thread, listMode->history});
+    }
 
     if (energyDeposit > 0.0f) {
         results.push_back (energyDeposit); // Store the energy deposit in the results vector
     } 
 
-
-    
+    return energyDeposit + annihilationDeposit;
 }
 
 template<RandomNumberGenerator GEN>
@@ -139,36 +152,46 @@ std::pair<float, float> PhotonAngleAndEnergy (GEN& getRandomNumber, float energy
         if (r3 < g) break;
     }
     
-    const float angle = std::acos (1.0f + b - b * f);
+    const float cosAngle = 1.0f + b - b * f;
     const float energy_out = energy_in / f;
     
-    return {angle, energy_out};
+    return {cosAngle, energy_out};
 }
 
 template<RandomNumberGenerator GEN>
-Vector DirectionInComptonScatter (GEN& getRandomNumber, const float angle)
+Vector DirectionInComptonScatter (GEN& getRandomNumber, const float cosAngle)
 {
-    const float nz = std::cos (angle);
-    const float rho = std::sin (angle);
+    const float nz = cosAngle;
+    const float rho = SinFromCos (cosAngle);
     const float phi = 2 * myMPI * getRandomNumber ();
+    float sinPhi;
+    float cosPhi;
+    FastSinCos (phi, sinPhi, cosPhi);
 
-    return {rho * std::cos (phi), rho * std::sin (phi), nz};
+    return {rho * cosPhi, rho * sinPhi, nz};
 }
 
 template<RandomNumberGenerator GEN>
 std::pair<Vector, float> ComptonScatter (GEN& getRandomNumber, const Vector& direction, const float energy_in)
 {
-    const auto [angle, energy_out] = PhotonAngleAndEnergy (getRandomNumber, energy_in);
-    const Vector newDirection = DirectionInComptonScatter (getRandomNumber, angle);
+    const auto [cosAngle, energy_out] = PhotonAngleAndEnergy (getRandomNumber, energy_in);
+    const Vector newDirection = DirectionInComptonScatter (getRandomNumber, cosAngle);
     const Vector newDirectionInParticlesCoordinateSystem = TransfromDirection (newDirection, direction); // Transform to the original coordinate system
     return {newDirectionInParticlesCoordinateSystem, energy_out};
 }
 
 template<RandomNumberGenerator GEN>
-void PairProduction (GEN& getRandomNumber, const Vector& position, const std::map<float, InteractionData>& crossSections, std::vector<float>&  results, std::mutex& results_mutex,const float R, const float H)
+float PairProduction (GEN& getRandomNumber, const Vector& position, const std::map<float, InteractionData>& crossSections, std::vector<float>&  results,const float R, const float H, ListModeBuffer* listMode)
 {
     Vector direction1 = GetIsotropicDirectionMarsaglia (getRandomNumber);
     Vector direction2 = {-1 * direction1.x, -1 * direction1.y, -1 * direction1.z};
-    TrackPhoton (getRandomNumber, position, direction1, 0.511f, crossSections, results, results_mutex, R, H);
-    TrackPhoton (getRandomNumber, position, direction2, 0.511f, crossSections, results, results_mutex, R, H);
+    if (listMode) {
+        listMode->track = annihilationTrack;
+    }
+    float energyDeposit = TrackPhoton (getRandomNumber, position, direction1, 0.511f, crossSections, results, R, H, listMode);
+    energyDeposit += TrackPhoton (getRandomNumber, position, direction2, 0.511f, crossSections, results, R, H, listMode);
+    if (listMode) {
+        listMode->track = primaryTrack;
+    }
+    return energyDeposit;
 }
\ No newline at end of file
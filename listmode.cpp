@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "listmode.hpp"
+
+
+ListModeWriter::ListModeWriter (const std::string& filename, const size_t bufferRecords, const size_t maxBufferedRecords) :
+    file (filename, std::ios::binary),
+    bufferRecords (bufferRecords > 0 ? bufferRecords : 1),
+    maxBufferedRecords (std::max (maxBufferedRecords, this->bufferRecords))
+{
+    if (!file.is_open ()) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return;
+    }
+    ListModeHeader header {};
+    std::memcpy (header.magic, listModeMagic, sizeof (header.magic));
+    header.version = listModeVersion;
+    header.recordSize = sizeof (ListModeRecord);
+    file.write (reinterpret_cast<const char*> (&header), sizeof (header));
+
+    front.reserve (this->bufferRecords);
+    back.reserve (this->bufferRecords);
+    worker = std::thread (&ListModeWriter::Run, this);
+}
+
+ListModeWriter::~ListModeWriter ()
+{
+    if (!worker.joinable ()) return;
+    Flush ();
+    {
+        std::lock_guard<std::mutex> lock (bufferMutex);
+        finished = true;
+    }
+    backReady.notify_all ();
+    worker.join ();
+}
+
+void ListModeWriter::Append (const ListModeRecord* records, const size_t count)
+{
+    if (!worker.joinable ()) return;
+    std::unique_lock<std::mutex> lock (bufferMutex);
+    // the disk is behind by a full front buffer already, wait for the back buffer to be written
+    backWritten.wait (lock, [this, count] { return !backPending || front.size () + count <= maxBufferedRecords; });
+    front.insert (front.end (), records, records + count);
+    numRecords += count;
+    // hand the full front buffer over unless the previous one is still on its way to disk
+    if (front.size () >= bufferRecords && !backPending) {
+        std::swap (front, back);
+        backPending = true;
+        backReady.notify_one ();
+    }
+}
+
+void ListModeWriter::Flush ()
+{
+    if (!worker.joinable ()) return;
+    std::unique_lock<std::mutex> lock (bufferMutex);
+    backWritten.wait (lock, [this] { return !backPending; });
+    if (!front.empty ()) {
+        std::swap (front, back);
+        backPending = true;
+        backReady.notify_one ();
+        backWritten.wait (lock, [this] { return !backPending; });
+    }
+    file.flush ();
+}
+
+void ListModeWriter::Run ()
+{
+    std::unique_lock<std::mutex> lock (bufferMutex);
+    while (true) {
+        backReady.wait (lock, [this] { return backPending || finished; });
+        if (!backPending) {
+            return;
+        }
+        lock.unlock ();
+        file.write (reinterpret_cast<const char*> (back.data ()), back.size () * sizeof (ListModeRecord));
+        back.clear ();
+        lock.lock ();
+        backPending = false;
+        backWritten.notify_all ();
+        // the front buffer may have filled up while the disk was busy
+        if (front.size () >= bufferRecords) {
+            std::swap (front, back);
+            backPending = true;
+        }
+    }
+}
+
+
+ListModeBuffer::ListModeBuffer (ListModeWriter& writer, const std::uint32_t thread, const size_t capacity) :
+    thread (thread),
+    writer (writer),
+    capacity (capacity > 0 ? capacity : 1)
+{
+    records.reserve (this->capacity);
+}
+
+ListModeBuffer::~ListModeBuffer ()
+{
+    Flush ();
+}
+
+void ListModeBuffer::Flush ()
+{
+    if (records.empty ()) return;
+    writer.Append (records.data (), records.size ());
+    records.clear ();
+}
+
+
+std::ifstream OpenListModeFile (const std::string& filename)
+{
+    std::ifstream file (filename, std::ios::binary);
+    if (!file.is_open ()) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return file;
+    }
+
+    ListModeHeader header {};
+    if (!file.read (reinterpret_cast<char*> (&header), sizeof (header)) ||
+        std::memcmp (header.magic, listModeMagic, sizeof (header.magic)) != 0 ||
+        header.version != listModeVersion || header.recordSize != sizeof (ListModeRecord)) {
+        std::cerr << "Error: " << filename << " is not a version " << listModeVersion << " list-mode file" << std::endl;
+        file.close ();
+    }
+    return file;
+}
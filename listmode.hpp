@@ -0,0 +1,114 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "geometry.hpp"
+
+
+// Binary list-mode file: one ListModeHeader followed by fixed-size ListModeRecords,
+// little endian, one record per tallied track (the same entries as the results vector).
+// Records with the same thread and history belong to the same source photon.
+constexpr char listModeMagic[4] = {'P', 'T', 'L', 'M'};
+constexpr std::uint32_t listModeVersion = 2;
+
+enum ListModeTrack : std::uint16_t {
+    primaryTrack = 0,
+    annihilationTrack = 1 // one of the two 0.511 MeV photons of a pair production
+};
+
+struct ListModeHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint32_t reserved;
+};
+
+struct ListModeRecord {
+    float deposit; // MeV
+    float firstX; // first interaction position, cm
+    float firstY;
+    float firstZ;
+    float sourceDirX; // direction of the source photon
+    float sourceDirY;
+    float sourceDirZ;
+    std::uint16_t numScatters; // Compton scatters of this track
+    std::uint16_t track; // ListModeTrack
+    std::uint32_t thread; // transport thread of the source photon
+    std::uint32_t history; // index of the source photon within its thread, misses included
+};
+
+static_assert (sizeof (ListModeHeader) == 16);
+static_assert (sizeof (ListModeRecord) == 40);
+
+
+// Sequential writer with a front buffer the transport threads append to and a back buffer
+// a background thread writes to disk. When the disk lags, the front buffer grows up to
+// maxBufferedRecords instead of making the transport wait. Past that Append blocks until the
+// back buffer is written: this backpressure is deliberate, it bounds the memory to about two
+// times maxBufferedRecords records. Transport only stalls on a disk that stays slower than the
+// record rate, a larger maxBufferedRecords trades memory for riding out longer stalls.
+class ListModeWriter {
+public:
+    explicit ListModeWriter (const std::string& filename, const size_t bufferRecords = 1 << 20, const size_t maxBufferedRecords = 4 << 20);
+    ~ListModeWriter ();
+
+    ListModeWriter (const ListModeWriter&) = delete;
+    ListModeWriter& operator= (const ListModeWriter&) = delete;
+
+    bool IsOpen () const { return file.is_open (); }
+    void Append (const ListModeRecord* records, const size_t count);
+    // Writes everything appended so far and waits for the disk
+    void Flush ();
+    unsigned long long GetNumRecords () const { return numRecords; }
+
+private:
+    void Run ();
+
+    std::ofstream file;
+    const size_t bufferRecords;
+    const size_t maxBufferedRecords; // front buffer limit while the back buffer is being written
+    std::vector<ListModeRecord> front;
+    std::vector<ListModeRecord> back;
+    std::mutex bufferMutex;
+    std::condition_variable backReady;
+    std::condition_variable backWritten;
+    bool backPending = false;
+    bool finished = false;
+    unsigned long long numRecords = 0;
+    std::thread worker;
+};
+
+// Per-thread staging buffer, hands its records to the writer in blocks
+class ListModeBuffer {
+public:
+    ListModeBuffer (ListModeWriter& writer, const std::uint32_t thread, const size_t capacity = 4096);
+    ~ListModeBuffer ();
+
+    void Push (const ListModeRecord& record)
+    {
+        records.push_back (record);
+        if (records.size () >= capacity) {
+            Flush ();
+        }
+    }
+    void Flush ();
+
+    // of the event currently being tracked
+    Vector sourceDirection = {0.0f, 0.0f, 0.0f};
+    std::uint32_t history = 0;
+    std::uint16_t track = primaryTrack;
+    const std::uint32_t thread;
+
+private:
+    ListModeWriter& writer;
+    const size_t capacity;
+    std::vector<ListModeRecord> records;
+};
+
+// Opens a list-mode file positioned at the first record, the stream is closed on a
+// missing file or a header mismatch
+std::ifstream OpenListModeFile (const std::string& filename);
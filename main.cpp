@@ -1,91 +1,13 @@
-#include <iterator>
-#include "interactions.hpp"
+#include <climits>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include "simulation.hpp"
+#include "pipeline.hpp"
 #include "utility.hpp"
-#include <chrono>
-
-
-void RunMonteCarloSimulation (int32_t seed, long long numberOfNeutrons, const Vector& source, const std::map<float, InteractionData>& crossSections, std::vector<float>& results , std::mutex& resultMutex, std::atomic<int>& misses, const float E, const float R, const float H, const float alpha)
-{
-    std::mt19937 generator(seed);
-    std::uniform_real_distribution<float> randomNumber(0.0f, 1.0f);
-    auto getRandomNumber = [&generator, &randomNumber]() { 
-        return randomNumber(generator); 
-    };
-
-    for (int32_t i = 0; i < numberOfNeutrons; ++i) {
-        Vector direction = GetIsotropicDirectionInAngle (alpha, getRandomNumber);
-        direction = TransfromDirection (direction, {-source.x, -source.y, -source.z}); // Transform to the original coordinate system
-        const auto res = HitsCylinder (source, direction, R, H/2.0f, -H/2.0f);
-        if (!res.first) {
-            misses++;
-            continue; // Missed the cylinder;
-        }
-        Vector startingPosition = res.second;
-        TrackPhoton (getRandomNumber, startingPosition, direction, E, crossSections, results, resultMutex, R, H);
-    }
-}
-
-
-std::pair<float, float> PrepareSimulation (const int simId, const int numPhotons, const Vector& source, const std::map<float, InteractionData>& crossSections, const float E, const float R, const float H, const float FWHM)
-{
-    std::mutex results_mutex;
-    std::vector<std::thread> threads;
-    std::atomic<int> misses = 0;
-
-
-    unsigned int num_threads = std::thread::hardware_concurrency ();
-    threads.reserve (num_threads);
-    std::vector<float> results;
-    results.reserve (numPhotons / 2);
-
-
-    std::random_device rd;
-    std::vector<std::uint32_t> seed_values;
-    for (unsigned int i = 0; i < num_threads; ++i) {
-        seed_values.push_back (rd ());
-    }
-
-    const float rg = std::sqrt (R * R + (H * H) / 4.0f);
-    const float os = std::sqrt (source.x * source.x + source.y * source.y + source.z * source.z);
-    const float alpha = std::atan2 (rg, os);
-
-
-    std::cout << "----------------------------------------------------------------------" <<
-                 std::endl <<"starting simulation with " << num_threads << " threads" << std::endl;
-    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now ();
-    unsigned int baseNumPerThread = numPhotons / num_threads;
-    unsigned int remainder = numPhotons % num_threads;
-    for (unsigned int i = 0; i < num_threads; ++i) {
-        unsigned long long numNPhotonsForThread = baseNumPerThread + (i < remainder ? 1 : 0);
-        threads.emplace_back (RunMonteCarloSimulation, seed_values[i], numNPhotonsForThread, std::cref(source), std::cref(crossSections), std::ref(results), std::ref(results_mutex), std::ref(misses), E, R, H, alpha);
-    }
-    for (auto& thread : threads) {
-        thread.join ();
-    }
-    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now ();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (end - start);
-    std::cout << "Finished simulation " << std::endl;
-    std::cout << "Time taken (ms): " << duration.count () << std::endl << "----------------------------------------------------------------------" << std::endl;
-
-    const float totalEnergyDeposited = std::accumulate (results.begin (), results.end (), 0.0f);
-    const float totalEnergyEmitted = numPhotons * E * 2 / (1 - std::cos (alpha));
-    const float totalEnergyReached = numPhotons - misses * E;
-
-    const float totalEfficiency = totalEnergyDeposited / totalEnergyEmitted * 100.0f;
-    const float interactionEfficiency = totalEnergyDeposited / totalEnergyReached * 100.0f;
-
-
-    ApplyFWHM (results, FWHM);
-    const auto var = GetStatisticalUncertainty (results);
-
-    std::cout << "Statistical uncertainty: " << var << std::endl;
-
-
-    auto histogram = CreateHistogram (results, 0.0f, E + 0.1 * E, 1024);
-    std::string filename = "histogram_" + std::to_string (simId) + ".csv";
-    WriteHistogramToFile (histogram, filename);
-    return {totalEfficiency, interactionEfficiency};
-}
+#include "fastmathcheck.hpp"
+#include "material.hpp"
+#include "validation.hpp"
 
 
 
@@ -105,9 +27,9 @@ std::pair<float, float> PrepareSimulation (const int simId, const int numPhotons
     std::cout << "Source position: (" << source.x << ", " << source.y << ", " << source.z << ")" << std::endl;
     std::cout << "Energy: " << E << " MeV" << std::endl;
 
-    auto efficecnies = PrepareSimulation (0, numberOfNeutrons, source, crossSections, E, R, H, FWHM);
-    std::cout << "Total efficiency: " << efficecnies.first << "%" << std::endl;
-    std::cout << "Interaction efficiency: " << efficecnies.second << "%" << std::endl;
+    auto efficecnies = PrepareSimulation (0, numberOfNeutrons, source, crossSections, E, R, H, FWHM, ThreadingConfig {});
+    std::cout << "Total efficiency: " << efficecnies.totalEfficiency << "%" << std::endl;
+    std::cout << "Interaction efficiency: " << efficecnies.interactionEfficiency << "%" << std::endl;
 
 }*/
 
@@ -128,9 +50,9 @@ std::pair<float, float> PrepareSimulation (const int simId, const int numPhotons
     std::cout << "Source position: (" << source.x << ", " << source.y << ", " << source.z << ")" << std::endl;
     std::cout << "Energy: " << E << " MeV" << std::endl;
 
-    auto efficecnies = PrepareSimulation (0, numberOfNeutrons, source, crossSections, E, R, H, FWHM);
-    std::cout << "Total efficiency: " << efficecnies.first << "%" << std::endl;
-    std::cout << "Interaction efficiency: " << efficecnies.second << "%" << std::endl;
+    auto efficecnies = PrepareSimulation (0, numberOfNeutrons, source, crossSections, E, R, H, FWHM, ThreadingConfig {});
+    std::cout << "Total efficiency: " << efficecnies.totalEfficiency << "%" << std::endl;
+    std::cout << "Interaction efficiency: " << efficecnies.interactionEfficiency << "%" << std::endl;
 
 }*/
 
@@ -157,11 +79,11 @@ std::pair<float, float> PrepareSimulation (const int simId, const int numPhotons
         std::cout << "----------------------------------------------------------------------" << std::endl;
         std::cout << "Source position: (" << source.x << ", " << source.y << ", " << source.z << ")" << std::endl;
         std::cout << "Energy: " << E << " MeV" << std::endl;
-        auto efficecnies = PrepareSimulation (simId, numberOfNeutrons, {source.x, source.y, source.z}, crossSections, E, R, H, FWHM);
-        std::cout << "Total efficiency: " << efficecnies.first << "%" << std::endl;
-        totelEfficiencies.push_back (efficecnies.first);
-        interactionEfficiencies.push_back (efficecnies.second);
-        std::cout << "Interaction efficiency: " << efficecnies.second << "%" << std::endl;
+        auto efficecnies = PrepareSimulation (simId, numberOfNeutrons, {source.x, source.y, source.z}, crossSections, E, R, H, FWHM, ThreadingConfig {});
+        std::cout << "Total efficiency: " << efficecnies.totalEfficiency << "%" << std::endl;
+        totelEfficiencies.push_back (efficecnies.totalEfficiency);
+        interactionEfficiencies.push_back (efficecnies.interactionEfficiency);
+        std::cout << "Interaction efficiency: " << efficecnies.interactionEfficiency << "%" << std::endl;
         simId++;
     }
     std::cout << "----------------------------------------------------------------------" << std::endl;
@@ -177,31 +99,137 @@ std::pair<float, float> PrepareSimulation (const int simId, const int numPhotons
 
 }*/
 
-int main (void)
+// Non-negative integer argument, throws like std::stoul on anything else
+static unsigned long ParseCount (const std::string& value)
 {
+    if (value.empty () || value.find_first_not_of ("0123456789") != std::string::npos) {
+        throw std::invalid_argument (value);
+    }
+    return std::stoul (value);
+}
+
+int main (int argc, char* argv[])
+{
+    const std::vector<std::string> args (argv + 1, argv + argc);
+    if (!args.empty () && args[0] == "--check-fastmath") {
+        const auto accuracy = CheckFastMathAccuracy (10000000, 12345);
+        std::cout << "log max relative error: " << accuracy.logMaxRelError << std::endl;
+        std::cout << "sin max absolute error: " << accuracy.sinMaxAbsError << std::endl;
+        std::cout << "cos max absolute error: " << accuracy.cosMaxAbsError << std::endl;
+        std::cout << "free path chi2/dof: " << accuracy.freePath.chiSquare << "/" << accuracy.freePath.degreesOfFreedom << " p = " << accuracy.freePath.pValue << std::endl;
+        std::cout << "direction chi2/dof: " << accuracy.direction.chiSquare << "/" << accuracy.direction.degreesOfFreedom << " p = " << accuracy.direction.pValue << std::endl;
+        return 0;
+    }
+    if (args.size () == 3 && args[0] == "--compare-spectra") {
+        // e.g. a histogram from a FASTMATH=0 build against one from the default build
+        const auto result = CompareHistograms (ReadHistogramFromFile (args[1]), ReadHistogramFromFile (args[2]));
+        std::cout << "chi2/dof: " << result.chiSquare << "/" << result.degreesOfFreedom << " p = " << result.pValue << std::endl;
+        return result.pValue < 0.001 ? 1 : 0;
+    }
+
+    if (!args.empty () && args[0] == "--validate") {
+        ValidationOptions options;
+        size_t i = 1;
+        try {
+            for (; i < args.size (); ++i) {
+                if (args[i] == "--photons" && i + 1 < args.size ()) {
+                    options.numPhotons = ParseCount (args[++i]);
+                    if (options.numPhotons == 0 || options.numPhotons > INT_MAX) throw std::out_of_range ("photons");
+                } else if (args[i] == "--write-references") {
+                    options.writeReferences = true;
+                } else if (args[i] == "--write-speed-baseline") {
+                    options.writeSpeedBaseline = true;
+                } else if (args[i] == "--speed-tolerance" && i + 1 < args.size ()) {
+                    options.speedTolerance = std::stod (args[++i]);
+                } else {
+                    std::cerr << "Warning: Unknown argument " << args[i] << std::endl;
+                }
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value " << args[i] << " for " << args[i - 1] << std::endl;
+            return 1;
+        }
+        const auto failures = RunValidation (options, loadPhotonDataToMap ("corsssections.txt", 3.67f));
+        std::cout << "----------------------------------------------------------------------" << std::endl;
+        std::cout << (failures == 0 ? "validation passed" : "validation FAILED") << std::endl;
+        return failures == 0 ? 0 : 1;
+    }
+
+    ThreadingConfig threading;
+    bool writeListMode = false;
+    std::string materialSpec;
+    float Ro = 3.67f;
+    size_t i = 0;
+    try {
+        for (; i < args.size (); ++i) {
+            if (args[i] == "--threads" && i + 1 < args.size ()) {
+                threading.numThreads = ParseCount (args[++i]);
+            } else if (args[i] == "--pin") {
+                threading.pinThreads = true;
+            } else if (args[i] == "--no-replicate") {
+                threading.replicatePerNode = false;
+            } else if (args[i] == "--material" && i + 1 < args.size ()) {
+                materialSpec = args[++i]; // elemental tables and mass fractions, "Na.txt:0.153,I.txt:0.847"
+            } else if (args[i] == "--density" && i + 1 < args.size ()) {
+                Ro = std::stof (args[++i]);
+                if (!(Ro > 0.0f)) throw std::invalid_argument ("density");
+            } else if (args[i] == "--list-mode") {
+                writeListMode = true; // listmode_N.bin next to histogram_N.csv, read with tools/listmode_reader
+            } else {
+                std::cerr << "Warning: Unknown argument " << args[i] << std::endl;
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Error: Invalid value " << args[i] << " for " << args[i - 1] << std::endl;
+        return 1;
+    }
 
     const Vector source = {4.0f, 4.0f, 0.0f};
     std::vector Energies = linspace(0.4, 4.0, 10);
     const float R = 3.0f; // Radius of the cylinder in cm
     const float H = 5.0f; // Height of the cylinder in cm
-    const float Ro = 3.67f;
     const float FWHM = 8.0 / 1000.0f; // FWHM in MeV
     const long long numberOfNeutrons = 100000000; // Number of neutrons to simulate
-    std::map<float, InteractionData> crossSections = loadPhotonDataToMap ("corsssections.txt", Ro); // Load the cross-section data from a file
+    MaterialComposition composition {{}, Ro};
+    try {
+        if (!materialSpec.empty ()) composition = ParseComposition (materialSpec, Ro);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value " << materialSpec << " for --material: " << e.what () << std::endl;
+        return 1;
+    }
+    std::map<float, InteractionData> crossSections = materialSpec.empty () ?
+        loadPhotonDataToMap ("corsssections.txt", Ro) : // Load the cross-section data from a file
+        BuildMaterial (composition, "material_cache");
+    if (crossSections.empty ()) {
+        std::cerr << "Error: No cross-section data" << std::endl;
+        return 1;
+    }
 
     int cnt = 0;
     std::vector<float> totelEfficiencies;
     std::vector<float> interactionEfficiencies;
+    std::vector<std::future<EfficiencyEstimate>> pending;
+    std::cout << "Source position: (" << source.x << ", " << source.y << ", " << source.z << ")" << std::endl;
+
+    // post-processing of energy N runs in the background while energy N + 1 transports
+    SimulationPipeline pipeline;
     for (const auto& E : Energies) {
-        std::cout << "----------------------------------------------------------------------" << std::endl;
-        std::cout << "Simulation for energy: " << E << " MeV" << std::endl;
-        std::cout << "----------------------------------------------------------------------" << std::endl;
-        std::cout << "Source position: (" << source.x << ", " << source.y << ", " << source.z << ")" << std::endl;
-        auto efficecnies = PrepareSimulation (cnt, numberOfNeutrons, source, crossSections, E, R, H, FWHM);
-        totelEfficiencies.push_back (efficecnies.first);
-        interactionEfficiencies.push_back (efficecnies.second);
+        PrintLocked ("----------------------------------------------------------------------\nSimulation " + std::to_string (cnt) + " for energy: " + std::to_string (E) + " MeV");
+        std::unique_ptr<ListModeWriter> listMode;
+        if (writeListMode) {
+            listMode = std::make_unique<ListModeWriter> ("listmode_" + std::to_string (cnt) + ".bin");
+        }
+        TransportResult transport = RunTransport (cnt, numberOfNeutrons, source, crossSections, E, R, H, threading, 0, true, listMode.get ());
+        // the background stage writes the rest of the list-mode file, the next energy starts right away
+        pending.push_back (pipeline.Submit (std::move (transport), FWHM, std::move (listMode)));
         cnt++;
     }
+    for (auto& efficecnies : pending) {
+        const EfficiencyEstimate estimate = efficecnies.get ();
+        totelEfficiencies.push_back (estimate.totalEfficiency);
+        interactionEfficiencies.push_back (estimate.interactionEfficiency);
+    }
+    pipeline.Finish ();
 
     std::cout << "----------------------------------------------------------------------" << std::endl;
     std::cout << "Total efficiencies: ";
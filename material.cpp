@@ -0,0 +1,237 @@
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include "material.hpp"
+
+
+constexpr char materialCacheMagic[4] = {'P', 'T', 'M', 'T'};
+constexpr std::uint32_t materialCacheVersion = 1;
+
+struct MaterialCacheHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t hash;
+    std::uint64_t count;
+};
+
+
+static void HashBytes (std::uint64_t& hash, const void* data, const size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*> (data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull; // FNV-1a
+    }
+}
+
+std::uint64_t HashComposition (const MaterialComposition& composition)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (const auto& element : composition.elements) {
+        std::ifstream file (element.crossSectionFile, std::ios::binary);
+        const std::string contents ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+        HashBytes (hash, contents.data (), contents.size ());
+        HashBytes (hash, &element.massFraction, sizeof (element.massFraction));
+    }
+    return hash;
+}
+
+MaterialComposition ParseComposition (const std::string& spec, const float density)
+{
+    MaterialComposition composition {{}, density};
+    std::istringstream iss (spec);
+    std::string entry;
+    while (std::getline (iss, entry, ',')) {
+        const auto colon = entry.rfind (':');
+        if (colon == std::string::npos || colon == 0) {
+            throw std::invalid_argument ("material entry " + entry + " needs a file and a mass fraction");
+        }
+        const std::string fraction = entry.substr (colon + 1);
+        float massFraction = 0.0f;
+        size_t parsed = 0;
+        try {
+            massFraction = std::stof (fraction, &parsed);
+        } catch (const std::exception&) {
+            parsed = 0;
+        }
+        if (parsed == 0 || parsed != fraction.size () || !std::isfinite (massFraction) || massFraction < 0.0f) {
+            throw std::invalid_argument ("material entry " + entry + " needs a non-negative mass fraction");
+        }
+        composition.elements.push_back ({entry.substr (0, colon), massFraction});
+    }
+    if (composition.elements.empty ()) {
+        throw std::invalid_argument ("material needs at least one element");
+    }
+    return composition;
+}
+
+
+// Like getCrossSectionsAtEnergy, but clamps outside the table instead of absorbing
+static InteractionData InterpolateClamped (const std::map<float, InteractionData>& table, const float energy)
+{
+    auto upper = table.lower_bound (energy);
+    if (upper == table.end ()) {
+        return table.rbegin ()->second;
+    }
+    if (upper->first == energy || upper == table.begin ()) {
+        return upper->second;
+    }
+    auto lower = std::prev (upper);
+    const float t = (energy - lower->first) / (upper->first - lower->first);
+    return {
+        std::lerp (lower->second.incoherentScatter, upper->second.incoherentScatter, t),
+        std::lerp (lower->second.photoelAbsorb, upper->second.photoelAbsorb, t),
+        std::lerp (lower->second.pairProd, upper->second.pairProd, t)};
+}
+
+// Mass attenuation of the mixture (cm^2/g). The loader keeps both sides of an absorption edge as
+// two grid points 1e-6 MeV apart, so taking the union of all grids keeps every element's edges.
+static std::map<float, InteractionData> MixElements (const MaterialComposition& composition)
+{
+    std::vector<std::map<float, InteractionData>> tables;
+    float totalFraction = 0.0f;
+    for (const auto& element : composition.elements) {
+        if (!(element.massFraction >= 0.0f)) {
+            std::cerr << "Error: Negative mass fraction " << element.massFraction << " for " << element.crossSectionFile << std::endl;
+            return {};
+        }
+        tables.push_back (loadPhotonDataToMap (element.crossSectionFile, 1.0f));
+        if (tables.back ().empty ()) {
+            std::cerr << "Error: No cross-sections in " << element.crossSectionFile << std::endl;
+            return {};
+        }
+        totalFraction += element.massFraction;
+    }
+    if (tables.empty ()) {
+        return {};
+    }
+    // only rounding of the given fractions is normalized away, anything else is a typo
+    if (std::abs (totalFraction - 1.0f) > 1e-3f) {
+        std::cerr << "Error: Mass fractions sum to " << totalFraction << " instead of 1" << std::endl;
+        return {};
+    }
+
+    std::set<float> grid;
+    for (const auto& table : tables) {
+        for (const auto& [energy, data] : table) {
+            grid.insert (energy);
+        }
+    }
+
+    std::map<float, InteractionData> mixture;
+    for (const float energy : grid) {
+        InteractionData mixed {0.0f, 0.0f, 0.0f};
+        for (size_t i = 0; i < tables.size (); ++i) {
+            const float w = composition.elements[i].massFraction / totalFraction;
+            const InteractionData data = InterpolateClamped (tables[i], energy);
+            mixed.incoherentScatter += w * data.incoherentScatter;
+            mixed.photoelAbsorb += w * data.photoelAbsorb;
+            mixed.pairProd += w * data.pairProd;
+        }
+        mixture.emplace_hint (mixture.end (), energy, mixed);
+    }
+    return mixture;
+}
+
+// The cache file holds the table flattened: header, then energies and the three
+// cross-sections as four contiguous float arrays.
+static std::map<float, InteractionData> ReadMaterialCache (const std::filesystem::path& path, const std::uint64_t hash)
+{
+    std::map<float, InteractionData> table;
+    std::ifstream file (path, std::ios::binary);
+    MaterialCacheHeader header {};
+    if (!file.is_open () || !file.read (reinterpret_cast<char*> (&header), sizeof (header)) ||
+        std::memcmp (header.magic, materialCacheMagic, sizeof (header.magic)) != 0 ||
+        header.version != materialCacheVersion || header.hash != hash) {
+        return table;
+    }
+
+    std::vector<float> columns (4 * header.count);
+    if (!file.read (reinterpret_cast<char*> (columns.data ()), columns.size () * sizeof (float))) {
+        return table;
+    }
+    const float* energies = columns.data ();
+    const float* incoherent = energies + header.count;
+    const float* photoel = incoherent + header.count;
+    const float* pair = photoel + header.count;
+    for (size_t i = 0; i < header.count; ++i) {
+        table.emplace_hint (table.end (), energies[i], InteractionData {incoherent[i], photoel[i], pair[i]});
+    }
+    return table;
+}
+
+static void WriteMaterialCache (const std::filesystem::path& path, const std::uint64_t hash, const std::map<float, InteractionData>& table)
+{
+    std::error_code ec;
+    std::filesystem::create_directories (path.parent_path (), ec);
+    std::ofstream file (path, std::ios::binary);
+    if (!file.is_open ()) {
+        std::cerr << "Warning: Could not write material cache " << path << std::endl;
+        return;
+    }
+
+    MaterialCacheHeader header {};
+    std::memcpy (header.magic, materialCacheMagic, sizeof (header.magic));
+    header.version = materialCacheVersion;
+    header.hash = hash;
+    header.count = table.size ();
+
+    std::vector<float> columns (4 * table.size ());
+    size_t i = 0;
+    for (const auto& [energy, data] : table) {
+        columns[i] = energy;
+        columns[table.size () + i] = data.incoherentScatter;
+        columns[2 * table.size () + i] = data.photoelAbsorb;
+        columns[3 * table.size () + i] = data.pairProd;
+        i++;
+    }
+    file.write (reinterpret_cast<const char*> (&header), sizeof (header));
+    file.write (reinterpret_cast<const char*> (columns.data ()), columns.size () * sizeof (float));
+}
+
+std::map<float, InteractionData> BuildMaterial (const MaterialComposition& composition, const std::string& cacheDir)
+{
+    static std::mutex cacheMutex;
+    static std::map<std::uint64_t, std::map<float, InteractionData>> cache;
+
+    const std::uint64_t hash = HashComposition (composition);
+    std::map<float, InteractionData> massAttenuation;
+    {
+        std::lock_guard<std::mutex> lock (cacheMutex);
+        auto cached = cache.find (hash);
+        if (cached != cache.end ()) {
+            massAttenuation = cached->second;
+        }
+    }
+
+    if (massAttenuation.empty ()) {
+        std::ostringstream name;
+        name << "material_" << std::hex << hash << ".bin";
+        const std::filesystem::path path = std::filesystem::path (cacheDir) / name.str ();
+
+        massAttenuation = ReadMaterialCache (path, hash);
+        if (massAttenuation.empty ()) {
+            massAttenuation = MixElements (composition);
+            if (massAttenuation.empty ()) {
+                return massAttenuation;
+            }
+            WriteMaterialCache (path, hash, massAttenuation);
+        }
+        std::lock_guard<std::mutex> lock (cacheMutex);
+        cache[hash] = massAttenuation;
+    }
+
+    for (auto& [energy, data] : massAttenuation) {
+        data.incoherentScatter *= composition.density;
+        data.photoelAbsorb *= composition.density;
+        data.pairProd *= composition.density;
+    }
+    return massAttenuation;
+}
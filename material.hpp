@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "crosssections.hpp"
+
+
+struct ElementComponent {
+    std::string crossSectionFile; // elemental table in the format of corsssections.txt (cm^2/g)
+    float massFraction;
+};
+
+struct MaterialComposition {
+    std::vector<ElementComponent> elements;
+    float density; // g/cm^3
+};
+
+// Hash of the element tables' contents and the mass fractions. The density is not part of it,
+// it only scales the cached mass attenuation table.
+std::uint64_t HashComposition (const MaterialComposition& composition);
+
+// Mixture cross-sections (1/cm) on the union of the elemental energy grids, absorption edges
+// included. The density independent table is built once per composition hash, kept for the
+// rest of the process and stored as material_<hash>.bin in cacheDir for later runs. Returns an
+// empty table when an element table is missing, a fraction is negative or the fractions do not
+// sum to 1 within 1e-3.
+std::map<float, InteractionData> BuildMaterial (const MaterialComposition& composition, const std::string& cacheDir);
+
+// "NaI_Na.txt:0.153,NaI_I.txt:0.847" -> elements, the density is taken as given.
+// Throws std::invalid_argument on an empty spec, a malformed entry or a negative fraction.
+MaterialComposition ParseComposition (const std::string& spec, const float density);
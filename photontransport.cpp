@@ -0,0 +1,186 @@
+#include <climits>
+#include <cmath>
+#include <exception>
+#include <map>
+#include <string>
+#include "photontransport.h"
+#include "material.hpp"
+#include "simulation.hpp"
+#include "utility.hpp"
+
+
+struct pt_config {
+    float R = 0.0f;
+    float H = 0.0f;
+    std::map<float, InteractionData> crossSections;
+    Vector source = {0.0f, 0.0f, 0.0f};
+    float E = 0.0f;
+    float FWHM = 0.0f;
+    float maxEnergy = 0.0f;
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+int Fail (const int status, const std::string& message)
+{
+    lastError = message;
+    return status;
+}
+
+}
+
+
+int pt_api_version (void)
+{
+    return PT_API_VERSION;
+}
+
+const char* pt_last_error (void)
+{
+    return lastError.c_str ();
+}
+
+pt_config* pt_config_create (void)
+{
+    try {
+        return new pt_config;
+    } catch (const std::exception& e) {
+        Fail (PT_ERROR_RUN, e.what ());
+        return nullptr;
+    }
+}
+
+void pt_config_destroy (pt_config* config)
+{
+    delete config;
+}
+
+int pt_config_set_detector (pt_config* config, float radius, float height)
+{
+    if (!config || !(radius > 0.0f) || !(height > 0.0f) || !std::isfinite (radius) || !std::isfinite (height)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "detector needs a config and finite positive radius and height");
+    }
+    config->R = radius;
+    config->H = height;
+    return PT_OK;
+}
+
+int pt_config_set_material (pt_config* config, const char* cross_section_file, float density)
+{
+    if (!config || !cross_section_file || !(density > 0.0f) || !std::isfinite (density)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "material needs a config, a file name and a finite positive density");
+    }
+    try {
+        auto crossSections = loadPhotonDataToMap (cross_section_file, density);
+        if (crossSections.empty ()) {
+            return Fail (PT_ERROR_MATERIAL, std::string ("no cross-sections loaded from ") + cross_section_file);
+        }
+        config->crossSections = std::move (crossSections);
+    } catch (const std::exception& e) {
+        return Fail (PT_ERROR_MATERIAL, e.what ());
+    }
+    return PT_OK;
+}
+
+int pt_config_set_mixture (pt_config* config, const char* const* element_files, const float* mass_fractions,
+                           size_t num_elements, float density, const char* cache_dir)
+{
+    if (!config || !element_files || !mass_fractions || num_elements == 0 || !(density > 0.0f) || !std::isfinite (density)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "mixture needs a config, element files, mass fractions and a finite positive density");
+    }
+    try {
+        MaterialComposition composition {{}, density};
+        for (size_t i = 0; i < num_elements; ++i) {
+            if (!element_files[i] || !(mass_fractions[i] >= 0.0f) || !std::isfinite (mass_fractions[i])) {
+                return Fail (PT_ERROR_INVALID_ARGUMENT, "mixture element needs a file and a finite non-negative mass fraction");
+            }
+            composition.elements.push_back ({element_files[i], mass_fractions[i]});
+        }
+        auto crossSections = BuildMaterial (composition, cache_dir ? cache_dir : "material_cache");
+        if (crossSections.empty ()) {
+            return Fail (PT_ERROR_MATERIAL, "could not build the mixture cross-sections");
+        }
+        config->crossSections = std::move (crossSections);
+    } catch (const std::exception& e) {
+        return Fail (PT_ERROR_MATERIAL, e.what ());
+    }
+    return PT_OK;
+}
+
+int pt_config_set_source (pt_config* config, float x, float y, float z, float energy)
+{
+    if (!config || !std::isfinite (x) || !std::isfinite (y) || !std::isfinite (z) || !(energy > 0.0f) || !std::isfinite (energy)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "source needs a config, a finite position and a finite positive energy");
+    }
+    config->source = {x, y, z};
+    config->E = energy;
+    return PT_OK;
+}
+
+int pt_config_set_resolution (pt_config* config, float fwhm)
+{
+    if (!config || !(fwhm >= 0.0f) || !std::isfinite (fwhm)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "resolution needs a config and a finite non-negative fwhm");
+    }
+    config->FWHM = fwhm;
+    return PT_OK;
+}
+
+int pt_config_set_spectrum_range (pt_config* config, float max_energy)
+{
+    if (!config || !std::isfinite (max_energy)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "spectrum range needs a config and a finite max_energy");
+    }
+    config->maxEnergy = max_energy;
+    return PT_OK;
+}
+
+int pt_run (const pt_config* config, long long num_photons, unsigned int num_threads, uint32_t seed,
+            pt_efficiencies* efficiencies, uint64_t* spectrum, size_t spectrum_bins)
+{
+    if (!config || num_photons <= 0 || num_photons > INT_MAX || (!spectrum && spectrum_bins > 0)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "run needs a config, 0 < num_photons <= INT_MAX and a spectrum buffer for spectrum_bins");
+    }
+    if (config->crossSections.empty () || config->R <= 0.0f || config->E <= 0.0f) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "config needs a detector, a material and a source before running");
+    }
+    const float sourceDistance = std::sqrt (config->source.x * config->source.x + config->source.y * config->source.y + config->source.z * config->source.z);
+    // written so that a NaN distance fails as well
+    if (!(sourceDistance > std::sqrt (config->R * config->R + config->H * config->H / 4.0f)) || !std::isfinite (sourceDistance)) {
+        return Fail (PT_ERROR_INVALID_ARGUMENT, "source must lie outside the sphere enclosing the detector");
+    }
+
+    try {
+        ThreadingConfig threading;
+        threading.numThreads = num_threads;
+        TransportResult transport = RunTransport (0, static_cast<int> (num_photons), config->source, config->crossSections,
+                                                  config->E, config->R, config->H, threading, seed, false, nullptr);
+
+        if (efficiencies) {
+            const EfficiencyEstimate estimate = ComputeEfficiencies (transport);
+            efficiencies->total_efficiency = estimate.totalEfficiency;
+            efficiencies->total_efficiency_error = estimate.totalError;
+            efficiencies->interaction_efficiency = estimate.interactionEfficiency;
+            efficiencies->interaction_efficiency_error = estimate.interactionError;
+            efficiencies->num_photons = num_photons;
+            efficiencies->misses = transport.tally.misses;
+        }
+
+        if (spectrum_bins > 0) {
+            if (config->FWHM > 0.0f) {
+                if (seed == 0) {
+                    ApplyFWHM (transport.results, config->FWHM);
+                } else {
+                    ApplyFWHM (transport.results, config->FWHM, seed + 1);
+                }
+            }
+            const float maxEnergy = config->maxEnergy > 0.0f ? config->maxEnergy : config->E + 0.1f * config->E;
+            FillHistogram (transport.results, 0.0, maxEnergy, spectrum, spectrum_bins);
+        }
+    } catch (const std::exception& e) {
+        return Fail (PT_ERROR_RUN, e.what ());
+    }
+    return PT_OK;
+}
@@ -0,0 +1,87 @@
+#ifndef PHOTONTRANSPORT_H
+#define PHOTONTRANSPORT_H
+
+/*
+ * C API of libphotontransport (make lib).
+ *
+ * A pt_config holds the detector, material and source. The material table is loaded once
+ * by pt_config_set_material, so one config can be run many times, e.g. inside a fitting loop.
+ * pt_run writes efficiencies and the spectrum straight into caller-owned memory.
+ *
+ * Functions return PT_OK or one of the error codes below, pt_last_error gives a message
+ * for the last failure on the calling thread. A config must not be modified while it runs,
+ * but several threads may run the same config at once.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define PT_API __attribute__((visibility("default")))
+#else
+#define PT_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PT_API_VERSION 1
+
+enum pt_status {
+    PT_OK = 0,
+    PT_ERROR_INVALID_ARGUMENT = 1,
+    PT_ERROR_MATERIAL = 2,
+    PT_ERROR_RUN = 3
+};
+
+typedef struct pt_config pt_config;
+
+typedef struct pt_efficiencies {
+    double total_efficiency; /* deposited / emitted energy in percent */
+    double total_efficiency_error; /* standard error */
+    double interaction_efficiency; /* deposited / energy reaching the detector in percent */
+    double interaction_efficiency_error;
+    long long num_photons;
+    long long misses; /* photons not hitting the detector */
+} pt_efficiencies;
+
+PT_API int pt_api_version (void);
+PT_API const char* pt_last_error (void);
+
+PT_API pt_config* pt_config_create (void);
+PT_API void pt_config_destroy (pt_config* config);
+
+/* Cylinder centred at the origin with its axis along z, in cm */
+PT_API int pt_config_set_detector (pt_config* config, float radius, float height);
+/* Cross-section table in the format of corsssections.txt (cm^2/g), density in g/cm^3 */
+PT_API int pt_config_set_material (pt_config* config, const char* cross_section_file, float density);
+/*
+ * Mixture of num_elements elemental tables (same format) with the given mass fractions, which
+ * must be non-negative and sum to 1 (within 1e-3).
+ * The mixed table is cached per composition in cache_dir, NULL uses "material_cache".
+ */
+PT_API int pt_config_set_mixture (pt_config* config, const char* const* element_files, const float* mass_fractions,
+                                  size_t num_elements, float density, const char* cache_dir);
+/* Point source position in cm and photon energy in MeV */
+PT_API int pt_config_set_source (pt_config* config, float x, float y, float z, float energy);
+/* Gaussian energy resolution in MeV, 0 disables the broadening */
+PT_API int pt_config_set_resolution (pt_config* config, float fwhm);
+/* Spectrum range [0, max_energy] in MeV, max_energy <= 0 uses 1.1 * source energy (the default) */
+PT_API int pt_config_set_spectrum_range (pt_config* config, float max_energy);
+
+/*
+ * Transports num_photons on at most num_threads threads (0 = all cores).
+ * seed 0 seeds from the system, any other value gives bit for bit identical efficiencies and
+ * spectra for a fixed num_threads.
+ * efficiencies may be NULL. spectrum receives spectrum_bins counts and may be NULL when
+ * spectrum_bins is 0.
+ */
+PT_API int pt_run (const pt_config* config, long long num_photons, unsigned int num_threads, uint32_t seed,
+                   pt_efficiencies* efficiencies, uint64_t* spectrum, size_t spectrum_bins);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <stdexcept>
+#include "pipeline.hpp"
+
+
+SimulationPipeline::SimulationPipeline (const size_t queueCapacity) :
+    queueCapacity (queueCapacity > 0 ? queueCapacity : 1),
+    start (std::chrono::high_resolution_clock::now ()),
+    worker (&SimulationPipeline::Run, this)
+{
+}
+
+SimulationPipeline::~SimulationPipeline ()
+{
+    Finish ();
+}
+
+std::future<EfficiencyEstimate> SimulationPipeline::Submit (TransportResult&& transport, const float FWHM, std::unique_ptr<ListModeWriter> listMode)
+{
+    std::unique_lock<std::mutex> lock (queueMutex);
+    queueChanged.wait (lock, [this] { return queue.size () < queueCapacity || finished; });
+    if (finished) {
+        // the worker may have exited already, the job would never run
+        throw std::logic_error ("SimulationPipeline::Submit called after Finish");
+    }
+    transportMs += transport.transportMs;
+    queue.push_back ({std::move (transport), FWHM, {}, std::move (listMode)});
+    auto future = queue.back ().efficiencies.get_future ();
+    queueChanged.notify_all ();
+    return future;
+}
+
+void SimulationPipeline::Finish ()
+{
+    {
+        std::lock_guard<std::mutex> lock (queueMutex);
+        if (finished) return;
+        finished = true;
+    }
+    queueChanged.notify_all ();
+    worker.join ();
+
+    const auto wallMs = std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::high_resolution_clock::now () - start).count ();
+    const long long overlapMs = std::max (0LL, transportMs + postProcessMs - wallMs);
+    PrintLocked ("pipeline finished, wall time (ms): " + std::to_string (wallMs) + ", transport (ms): " + std::to_string (transportMs) +
+                 ", post-processing (ms): " + std::to_string (postProcessMs) + ", overlapped (ms): " + std::to_string (overlapMs));
+}
+
+void SimulationPipeline::Run ()
+{
+    while (true) {
+        std::unique_lock<std::mutex> lock (queueMutex);
+        queueChanged.wait (lock, [this] { return !queue.empty () || finished; });
+        if (queue.empty ()) {
+            return; // finished and drained
+        }
+        Job job = std::move (queue.front ());
+        queue.pop_front ();
+        queueChanged.notify_all ();
+        lock.unlock ();
+
+        try {
+            job.efficiencies.set_value (PostProcess (job.transport, job.FWHM));
+        } catch (...) {
+            job.efficiencies.set_exception (std::current_exception ());
+        }
+        job.listMode.reset (); // waits for the disk to catch up and closes the file
+
+
+        lock.lock ();
+        postProcessMs += job.transport.postProcessMs;
+    }
+}
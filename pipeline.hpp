@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "listmode.hpp"
+#include "simulation.hpp"
+
+
+// Runs PostProcess of finished transports on a background thread, so the next scenario
+// can transport meanwhile. Submit blocks once queueCapacity transports are waiting,
+// which bounds the number of result vectors alive at the same time. A list-mode writer passed
+// with the transport is flushed and closed on the background thread as well.
+class SimulationPipeline {
+public:
+    explicit SimulationPipeline (const size_t queueCapacity = 1);
+    ~SimulationPipeline ();
+
+    SimulationPipeline (const SimulationPipeline&) = delete;
+    SimulationPipeline& operator= (const SimulationPipeline&) = delete;
+
+    // Throws std::logic_error once Finish has been called
+    std::future<EfficiencyEstimate> Submit (TransportResult&& transport, const float FWHM, std::unique_ptr<ListModeWriter> listMode = nullptr);
+    // Waits for every submitted job and prints the timing summary
+    void Finish ();
+
+private:
+    struct Job {
+        TransportResult transport;
+        float FWHM;
+        std::promise<EfficiencyEstimate> efficiencies;
+        std::unique_ptr<ListModeWriter> listMode;
+    };
+
+    void Run ();
+
+    const size_t queueCapacity;
+    std::deque<Job> queue;
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    bool finished = false;
+
+    std::chrono::high_resolution_clock::time_point start;
+    long long transportMs = 0;
+    long long postProcessMs = 0;
+    std::thread worker;
+};
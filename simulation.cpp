@@ -0,0 +1,182 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include "simulation.hpp"
+#include "interactions.hpp"
+#include "utility.hpp"
+
+
+void RunMonteCarloSimulation (int32_t seed, long long numberOfNeutrons, const Vector& source, const std::map<float, InteractionData>& crossSections, std::vector<float>& results, TallyStatistics& tally, const float E, const float R, const float H, const float alpha, ListModeWriter* listMode, const std::uint32_t threadIndex)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> randomNumber(0.0f, 1.0f);
+    auto getRandomNumber = [&generator, &randomNumber]() { 
+        return randomNumber(generator); 
+    };
+
+    std::optional<ListModeBuffer> listModeBuffer;
+    if (listMode) {
+        listModeBuffer.emplace (*listMode, threadIndex);
+    }
+    ListModeBuffer* localListMode = listModeBuffer ? &*listModeBuffer : nullptr;
+
+    constexpr int32_t batchSize = 1024;
+    std::vector<Vector> sourceDirections (batchSize);
+
+    for (int32_t i = 0; i < numberOfNeutrons; ++i) {
+        const int32_t inBatch = i % batchSize;
+        if (inBatch == 0) {
+            GetIsotropicDirectionsInAngle (alpha, getRandomNumber, sourceDirections.data (), std::min<long long> (batchSize, numberOfNeutrons - i));
+        }
+        const Vector direction = TransfromDirection (sourceDirections[inBatch], {-source.x, -source.y, -source.z}); // Transform to the original coordinate system
+        const auto res = HitsCylinder (source, direction, R, H/2.0f, -H/2.0f);
+        if (!res.first) {
+            tally.AddMiss ();
+            continue; // Missed the cylinder;
+        }
+        Vector startingPosition = res.second;
+        if (localListMode) {
+            localListMode->sourceDirection = direction;
+            localListMode->history = static_cast<std::uint32_t> (i);
+        }
+        tally.AddHistory (TrackPhoton (getRandomNumber, startingPosition, direction, E, crossSections, results, R, H, localListMode));
+    }
+}
+
+
+TransportResult RunTransport (const int simId, const int numPhotons, const Vector& source, const std::map<float, InteractionData>& crossSections, const float E, const float R, const float H, const ThreadingConfig& threading, const std::uint32_t seed, const bool verbose, ListModeWriter* listMode)
+{
+    std::vector<std::thread> threads;
+
+    const auto placement = PlanThreadPlacement (threading, GetNumaTopology ());
+    const unsigned int num_threads = placement.size ();
+    threads.reserve (num_threads);
+    TallyTree tallies (num_threads);
+    std::vector<std::vector<float>> threadResults (num_threads);
+
+    // The first thread placed on a node builds that node's replica, the others wait for it
+    unsigned int num_nodes = 1;
+    for (const auto& p : placement) {
+        num_nodes = std::max (num_nodes, p.node + 1);
+    }
+    std::vector<std::unique_ptr<NodeData>> nodeData (num_nodes);
+    std::vector<std::unique_ptr<std::latch>> nodeReady;
+    std::vector<int> nodeLeader (num_nodes, -1);
+    for (unsigned int node = 0; node < num_nodes; ++node) {
+        nodeReady.push_back (std::make_unique<std::latch> (1));
+    }
+    for (unsigned int i = 0; i < num_threads; ++i) {
+        if (nodeLeader[placement[i].node] < 0) {
+            nodeLeader[placement[i].node] = i;
+        }
+    }
+    for (unsigned int node = 0; node < num_nodes; ++node) {
+        if (nodeLeader[node] < 0) {
+            nodeReady[node]->count_down (); // no thread landed on this node
+        }
+    }
+
+
+    std::random_device rd;
+    std::seed_seq seeds {seed};
+    std::vector<std::uint32_t> seed_values (num_threads);
+    if (seed == 0) {
+        for (auto& value : seed_values) {
+            value = rd ();
+        }
+    } else {
+        seeds.generate (seed_values.begin (), seed_values.end ());
+    }
+
+    const float rg = std::sqrt (R * R + (H * H) / 4.0f);
+    const float os = std::sqrt (source.x * source.x + source.y * source.y + source.z * source.z);
+    const float alpha = std::atan2 (rg, os);
+
+    auto worker = [&] (const unsigned int i, const unsigned long long numPhotonsForThread) {
+        const ThreadPlacement& p = placement[i];
+        if (p.cpu >= 0 && !PinCurrentThreadToCpu (p.cpu)) {
+            std::cerr << "Warning: Could not pin thread " << i << " to cpu " << p.cpu << std::endl;
+        }
+        if (nodeLeader[p.node] == static_cast<int> (i)) {
+            auto local = std::make_unique<NodeData> ();
+            local->crossSections = crossSections;
+            nodeData[p.node] = std::move (local);
+            nodeReady[p.node]->count_down ();
+        }
+        nodeReady[p.node]->wait ();
+        const NodeData& local = *nodeData[p.node];
+
+        // allocated and filled by this thread only, so it is node local and its order is reproducible
+        std::vector<float> localResults;
+        localResults.reserve (numPhotonsForThread / 2);
+        TallyStatistics& tally = tallies.Allocate (i);
+        RunMonteCarloSimulation (seed_values[i], numPhotonsForThread, source, local.crossSections, localResults, tally, E, R, H, alpha, listMode, i);
+        threadResults[i] = std::move (localResults);
+        tallies.Reduce (i);
+    };
+
+
+    if (verbose) PrintLocked ("starting simulation " + std::to_string (simId) + " with " + std::to_string (num_threads) + " threads on " + std::to_string (num_nodes) + " node(s)" + (threading.pinThreads ? ", pinned" : ""));
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now ();
+    unsigned int baseNumPerThread = numPhotons / num_threads;
+    unsigned int remainder = numPhotons % num_threads;
+    for (unsigned int i = 0; i < num_threads; ++i) {
+        unsigned long long numNPhotonsForThread = baseNumPerThread + (i < remainder ? 1 : 0);
+        threads.emplace_back (worker, i, numNPhotonsForThread);
+    }
+    for (auto& thread : threads) {
+        thread.join ();
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now ();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (end - start);
+    if (verbose) PrintLocked ("finished transport of simulation " + std::to_string (simId) + ", time taken (ms): " + std::to_string (duration.count ()));
+
+    // kept per thread, in thread order a fixed seed and thread count give the same results every run
+    return {simId, numPhotons, E, alpha, tallies.Total (), std::move (threadResults), duration.count ()};
+}
+
+EfficiencyEstimate ComputeEfficiencies (const TransportResult& transport)
+{
+    return EstimateEfficiencies (transport.tally, transport.E, transport.alpha);
+}
+
+EfficiencyEstimate PostProcess (TransportResult& transport, const float FWHM)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now ();
+    std::vector<std::vector<float>>& results = transport.results;
+    const float E = transport.E;
+    const EfficiencyEstimate efficiencies = ComputeEfficiencies (transport);
+
+    ApplyFWHM (results, FWHM);
+    auto histogram = CreateHistogram (results, 0.0f, E + 0.1 * E, 1024);
+    std::string filename = "histogram_" + std::to_string (transport.simId) + ".csv";
+    WriteHistogramToFile (histogram, filename);
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now ();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds> (end - start);
+    transport.postProcessMs = duration.count ();
+    PrintLocked ("post-processed simulation " + std::to_string (transport.simId) + " (E = " + std::to_string (E) + " MeV)" +
+                 ", total efficiency: " + std::to_string (efficiencies.totalEfficiency) + " +- " + std::to_string (efficiencies.totalError) + "%" +
+                 ", interaction efficiency: " + std::to_string (efficiencies.interactionEfficiency) + " +- " + std::to_string (efficiencies.interactionError) + "%" +
+                 ", mean deposit: " + std::to_string (efficiencies.meanDeposit) + " MeV (std " + std::to_string (efficiencies.depositStdDev) + ")" +
+                 ", time taken (ms): " + std::to_string (duration.count ()));
+    return efficiencies;
+}
+
+EfficiencyEstimate PrepareSimulation (const int simId, const int numPhotons, const Vector& source, const std::map<float, InteractionData>& crossSections, const float E, const float R, const float H, const float FWHM, const ThreadingConfig& threading)
+{
+    TransportResult transport = RunTransport (simId, numPhotons, source, crossSections, E, R, H, threading, 0, true, nullptr);
+    return PostProcess (transport, FWHM);
+}
+
+void PrintLocked (const std::string& message)
+{
+    static std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock (outputMutex);
+    std::cout << message << std::endl;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "crosssections.hpp"
+#include "geometry.hpp"
+#include "listmode.hpp"
+#include "tally.hpp"
+#include "threading.hpp"
+
+
+// Raw output of the transport stage, everything PostProcess needs without the geometry
+struct TransportResult {
+    int simId;
+    int numPhotons;
+    float E;
+    float alpha; // half opening angle of the source cone
+    TallyStatistics tally;
+    std::vector<std::vector<float>> results; // energy deposits of every thread, in thread order
+    long long transportMs;
+    long long postProcessMs = 0;
+};
+
+void RunMonteCarloSimulation (int32_t seed, long long numberOfNeutrons, const Vector& source, const std::map<float, InteractionData>& crossSections, std::vector<float>& results, TallyStatistics& tally, const float E, const float R, const float H, const float alpha, ListModeWriter* listMode, const std::uint32_t threadIndex);
+// seed 0 seeds the threads from std::random_device, any other value makes the thread seeds reproducible.
+// listMode may be null, otherwise every tallied track is appended to it before returning. The
+// caller flushes it, e.g. by handing it to SimulationPipeline::Submit.
+TransportResult RunTransport (const int simId, const int numPhotons, const Vector& source, const std::map<float, InteractionData>& crossSections, const float E, const float R, const float H, const ThreadingConfig& threading, const std::uint32_t seed, const bool verbose, ListModeWriter* listMode);
+EfficiencyEstimate ComputeEfficiencies (const TransportResult& transport);
+// Efficiencies, FWHM broadening and histogram output of a finished transport
+EfficiencyEstimate PostProcess (TransportResult& transport, const float FWHM);
+EfficiencyEstimate PrepareSimulation (const int simId, const int numPhotons, const Vector& source, const std::map<float, InteractionData>& crossSections, const float E, const float R, const float H, const float FWHM, const ThreadingConfig& threading);
+// Progress output shared by the transport and the post-processing stage
+void PrintLocked (const std::string& message);
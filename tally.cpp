@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cmath>
+#include "tally.hpp"
+
+
+void TallyStatistics::Merge (const TallyStatistics& other)
+{
+    histories += other.histories;
+    misses += other.misses;
+    depositingHistories += other.depositingHistories;
+    deposit.Merge (other.deposit);
+    depositSquared.Merge (other.depositSquared);
+}
+
+
+TallyTree::TallyTree (const unsigned int numThreads) :
+    tallies (numThreads > 0 ? numThreads : 1)
+{
+    for (size_t i = 0; i < tallies.size (); ++i) {
+        done.push_back (std::make_unique<std::latch> (1));
+    }
+}
+
+TallyStatistics& TallyTree::Allocate (const unsigned int i)
+{
+    tallies[i] = std::make_unique<Slot> ();
+    return tallies[i]->tally;
+}
+
+void TallyTree::Reduce (const unsigned int i)
+{
+    const size_t n = tallies.size ();
+    for (size_t step = 1; step < n; step *= 2) {
+        if (i % (2 * step) != 0) break;
+        if (i + step < n) {
+            done[i + step]->wait ();
+            tallies[i]->tally.Merge (tallies[i + step]->tally);
+        }
+    }
+    done[i]->count_down ();
+}
+
+
+// Standard error of the mean of n samples with the given sum and sum of squares
+static double StandardError (const double sum, const double sumSquared, const double n)
+{
+    if (n < 2.0) {
+        return 0.0;
+    }
+    const double mean = sum / n;
+    const double variance = std::max (0.0, (sumSquared / n - mean * mean) * n / (n - 1.0));
+    return std::sqrt (variance / n);
+}
+
+EfficiencyEstimate EstimateEfficiencies (const TallyStatistics& tally, const float E, const float alpha)
+{
+    EfficiencyEstimate estimate {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const double sum = tally.deposit.Value ();
+    const double sumSquared = tally.depositSquared.Value ();
+
+    // every history is a photon in the cone, which is the fraction (1 - cos(alpha)) / 2 of the full emission
+    const double histories = static_cast<double> (tally.histories);
+    if (histories > 0.0) {
+        const double scale = 100.0 * (1.0 - std::cos (alpha)) / 2.0 / E;
+        estimate.totalEfficiency = sum / histories * scale;
+        estimate.totalError = StandardError (sum, sumSquared, histories) * scale;
+    }
+
+    const double reached = static_cast<double> (tally.histories - tally.misses);
+    if (reached > 0.0) {
+        const double scale = 100.0 / E;
+        estimate.interactionEfficiency = sum / reached * scale;
+        estimate.interactionError = StandardError (sum, sumSquared, reached) * scale;
+    }
+
+    const double depositing = static_cast<double> (tally.depositingHistories);
+    if (depositing > 0.0) {
+        estimate.meanDeposit = sum / depositing;
+        estimate.depositStdDev = std::sqrt (std::max (0.0, sumSquared / depositing - estimate.meanDeposit * estimate.meanDeposit));
+    }
+    return estimate;
+}
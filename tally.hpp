@@ -0,0 +1,92 @@
+#pragma once
+#include <cmath>
+#include <latch>
+#include <memory>
+#include <vector>
+
+
+// Neumaier compensated double sum, stays accurate over 1e8+ terms of mixed size
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void Add (const double value)
+    {
+        const double t = sum + value;
+        if (std::abs (sum) >= std::abs (value)) {
+            compensation += (sum - t) + value;
+        } else {
+            compensation += (value - t) + sum;
+        }
+        sum = t;
+    }
+    void Merge (const CompensatedSum& other)
+    {
+        Add (other.sum);
+        Add (other.compensation);
+    }
+    double Value () const { return sum + compensation; }
+};
+
+// Per-thread statistics of the source photon histories. A history's deposit includes the
+// annihilation photons of its pair productions.
+struct TallyStatistics {
+    unsigned long long histories = 0;
+    unsigned long long misses = 0; // histories whose photon does not hit the detector
+    unsigned long long depositingHistories = 0;
+    CompensatedSum deposit; // MeV
+    CompensatedSum depositSquared;
+
+    void AddMiss ()
+    {
+        histories++;
+        misses++;
+    }
+    void AddHistory (const double energyDeposit)
+    {
+        histories++;
+        if (energyDeposit > 0.0) {
+            depositingHistories++;
+            deposit.Add (energyDeposit);
+            depositSquared.Add (energyDeposit * energyDeposit);
+        }
+    }
+    void Merge (const TallyStatistics& other);
+};
+
+// Tree reduction run by the workers themselves: when worker i is done it merges the tallies of
+// i + 1, i + 2, i + 4, ... as they finish, so slot 0 holds the total once every worker returned.
+class TallyTree {
+public:
+    explicit TallyTree (const unsigned int numThreads);
+
+    // Called once by worker i on its own thread before its first history, so the tally is
+    // first-touched on the worker's NUMA node
+    TallyStatistics& Allocate (const unsigned int i);
+    // Called once by worker i after its last history
+    void Reduce (const unsigned int i);
+    // Valid after every worker called Reduce
+    const TallyStatistics& Total () const { return tallies[0]->tally; }
+
+private:
+    // one cache line per worker, the workers update their slot after every history
+    struct alignas (64) Slot {
+        TallyStatistics tally;
+    };
+
+    std::vector<std::unique_ptr<Slot>> tallies;
+    std::vector<std::unique_ptr<std::latch>> done;
+};
+
+// Efficiencies in percent with their standard errors
+struct EfficiencyEstimate {
+    double totalEfficiency; // deposited / emitted energy
+    double totalError;
+    double interactionEfficiency; // deposited / energy of the photons reaching the detector
+    double interactionError;
+    double meanDeposit; // MeV, over the histories that deposit energy
+    double depositStdDev;
+};
+
+// alpha is the half opening angle of the sampled source cone
+EfficiencyEstimate EstimateEfficiencies (const TallyStatistics& tally, const float E, const float alpha);
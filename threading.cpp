@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include "threading.hpp"
+
+
+std::vector<unsigned int> ParseCpuList (const std::string& cpuList)
+{
+    std::vector<unsigned int> cpus;
+    std::istringstream iss (cpuList);
+    std::string range;
+    while (std::getline (iss, range, ',')) {
+        if (range.empty () || range == "\n") continue;
+        const auto dash = range.find ('-');
+        try {
+            if (dash == std::string::npos) {
+                cpus.push_back (std::stoul (range));
+            } else {
+                const unsigned int first = std::stoul (range.substr (0, dash));
+                const unsigned int last = std::stoul (range.substr (dash + 1));
+                for (unsigned int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back (cpu);
+                }
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Warning: Failed to parse cpu list: " << cpuList << std::endl;
+            return {};
+        }
+    }
+    return cpus;
+}
+
+std::vector<std::vector<unsigned int>> GetNumaTopology ()
+{
+    std::vector<std::vector<unsigned int>> topology;
+    const std::filesystem::path nodeRoot = "/sys/devices/system/node";
+
+    std::error_code ec;
+    for (unsigned int node = 0; std::filesystem::exists (nodeRoot / ("node" + std::to_string (node)), ec); ++node) {
+        std::ifstream file (nodeRoot / ("node" + std::to_string (node)) / "cpulist");
+        std::string line;
+        std::getline (file, line);
+        auto cpus = ParseCpuList (line);
+        if (!cpus.empty ()) {
+            topology.push_back (std::move (cpus));
+        }
+    }
+
+    if (topology.empty ()) {
+        std::vector<unsigned int> cpus;
+        for (unsigned int cpu = 0; cpu < std::max (1u, std::thread::hardware_concurrency ()); ++cpu) {
+            cpus.push_back (cpu);
+        }
+        topology.push_back (std::move (cpus));
+    }
+    return topology;
+}
+
+unsigned int GetNumThreads (const ThreadingConfig& config)
+{
+    if (config.numThreads > 0) {
+        return config.numThreads;
+    }
+    return std::max (1u, std::thread::hardware_concurrency ());
+}
+
+std::vector<ThreadPlacement> PlanThreadPlacement (const ThreadingConfig& config, const std::vector<std::vector<unsigned int>>& topology)
+{
+    const unsigned int numThreads = GetNumThreads (config);
+    std::vector<ThreadPlacement> placement;
+    placement.reserve (numThreads);
+
+    if (!config.pinThreads || topology.empty ()) {
+        for (unsigned int i = 0; i < numThreads; ++i) {
+            placement.push_back ({-1, 0});
+        }
+        return placement;
+    }
+
+    std::vector<size_t> nextCpu (topology.size (), 0);
+    for (unsigned int i = 0; i < numThreads; ++i) {
+        const unsigned int node = i % topology.size ();
+        const auto& cpus = topology[node];
+        const unsigned int cpu = cpus[nextCpu[node] % cpus.size ()];
+        nextCpu[node]++;
+        placement.push_back ({static_cast<int> (cpu), config.replicatePerNode ? node : 0});
+    }
+    return placement;
+}
+
+bool PinCurrentThreadToCpu (const unsigned int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (cpu, &set);
+    return pthread_setaffinity_np (pthread_self (), sizeof (set), &set) == 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "crosssections.hpp"
+
+
+struct ThreadingConfig {
+    unsigned int numThreads = 0; // 0 uses std::thread::hardware_concurrency
+    bool pinThreads = false; // pin every worker to one cpu
+    bool replicatePerNode = true; // per NUMA node copies of the cross-sections, needs pinThreads
+};
+
+struct ThreadPlacement {
+    int cpu; // -1 when the thread is not pinned
+    unsigned int node;
+};
+
+// Read-only data owned by one NUMA node, built by a thread running on that node so first-touch
+// places the pages locally. The tallies and results are per thread and allocated by their thread.
+struct NodeData {
+    std::map<float, InteractionData> crossSections;
+};
+
+// cpus of every NUMA node, from /sys/devices/system/node, a single node with all cpus otherwise
+std::vector<std::vector<unsigned int>> GetNumaTopology ();
+std::vector<unsigned int> ParseCpuList (const std::string& cpuList);
+// Spreads the threads round robin over the nodes, and over the cpus within a node
+std::vector<ThreadPlacement> PlanThreadPlacement (const ThreadingConfig& config, const std::vector<std::vector<unsigned int>>& topology);
+bool PinCurrentThreadToCpu (const unsigned int cpu);
+unsigned int GetNumThreads (const ThreadingConfig& config);
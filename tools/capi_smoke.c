@@ -0,0 +1,73 @@
+/*
+ * Smoke test of the C API (make capi-smoke): two runs with the same seed and thread count
+ * must give bit for bit identical efficiencies and spectra, and non-finite input must be rejected.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "photontransport.h"
+
+#define NUM_BINS 1024
+#define NUM_PHOTONS 200000
+#define NUM_THREADS 2
+#define SEED 12345u
+
+static int Run (const pt_config* config, pt_efficiencies* efficiencies, uint64_t* spectrum)
+{
+    if (pt_run (config, NUM_PHOTONS, NUM_THREADS, SEED, efficiencies, spectrum, NUM_BINS) != PT_OK) {
+        fprintf (stderr, "Error: pt_run failed: %s\n", pt_last_error ());
+        return 0;
+    }
+    return 1;
+}
+
+int main (void)
+{
+    static uint64_t first[NUM_BINS];
+    static uint64_t second[NUM_BINS];
+    pt_efficiencies firstEfficiencies;
+    pt_efficiencies secondEfficiencies;
+    memset (&firstEfficiencies, 0, sizeof (firstEfficiencies));
+    memset (&secondEfficiencies, 0, sizeof (secondEfficiencies));
+
+    pt_config* config = pt_config_create ();
+    if (!config || pt_config_set_detector (config, 2.5f, 3.0f) != PT_OK ||
+        pt_config_set_material (config, "corsssections.txt", 3.67f) != PT_OK ||
+        pt_config_set_source (config, 3.0f, -3.0f, 2.0f, 0.6617f) != PT_OK ||
+        pt_config_set_resolution (config, 6.0f / 1000.0f) != PT_OK) {
+        fprintf (stderr, "Error: could not set up the config: %s\n", pt_last_error ());
+        pt_config_destroy (config);
+        return 1;
+    }
+
+    const int ran = Run (config, &firstEfficiencies, first) && Run (config, &secondEfficiencies, second);
+    const int rejected = pt_config_set_source (config, NAN, 1.0f, 1.0f, 0.6617f) == PT_ERROR_INVALID_ARGUMENT &&
+                         pt_config_set_source (config, 3.0f, -3.0f, 2.0f, INFINITY) == PT_ERROR_INVALID_ARGUMENT &&
+                         pt_config_set_resolution (config, NAN) == PT_ERROR_INVALID_ARGUMENT &&
+                         pt_config_set_detector (config, INFINITY, 3.0f) == PT_ERROR_INVALID_ARGUMENT;
+    pt_config_destroy (config);
+    if (!ran) {
+        return 1;
+    }
+    if (!rejected) {
+        fprintf (stderr, "FAILED: non-finite input was accepted\n");
+        return 1;
+    }
+
+    if (memcmp (&firstEfficiencies, &secondEfficiencies, sizeof (pt_efficiencies)) != 0) {
+        fprintf (stderr, "FAILED: efficiencies differ between same-seed runs (%.9g vs %.9g)\n",
+                 firstEfficiencies.total_efficiency, secondEfficiencies.total_efficiency);
+        return 1;
+    }
+    for (size_t i = 0; i < NUM_BINS; ++i) {
+        if (first[i] != second[i]) {
+            fprintf (stderr, "FAILED: spectrum bin %zu differs between same-seed runs (%llu vs %llu)\n",
+                     i, (unsigned long long) first[i], (unsigned long long) second[i]);
+            return 1;
+        }
+    }
+    printf ("passed: same-seed runs match, total efficiency %.6f +- %.6f%%\n",
+            firstEfficiencies.total_efficiency, firstEfficiencies.total_efficiency_error);
+    return 0;
+}
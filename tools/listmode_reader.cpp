@@ -0,0 +1,66 @@
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "listmode.hpp"
+
+// Non-negative integer argument, throws like std::stoull on anything else
+static unsigned long long ParseCount (const std::string& value)
+{
+    if (value.empty () || value.find_first_not_of ("0123456789") != std::string::npos) {
+        throw std::invalid_argument (value);
+    }
+    return std::stoull (value);
+}
+
+// Summary of a list-mode file, with --csv N the first N records are printed as well
+int main (int argc, char* argv[])
+{
+    if (argc != 2 && !(argc == 4 && std::string (argv[2]) == "--csv")) {
+        std::cerr << "usage: " << argv[0] << " <listmode.bin> [--csv N]" << std::endl;
+        return 1;
+    }
+    unsigned long long numCsv = 0;
+    try {
+        numCsv = argc == 4 ? ParseCount (argv[3]) : 0;
+    } catch (const std::exception&) {
+        std::cerr << "Error: Invalid value " << argv[3] << " for --csv" << std::endl;
+        return 1;
+    }
+    std::ifstream file = OpenListModeFile (argv[1]);
+    if (!file.is_open ()) {
+        return 1;
+    }
+    if (numCsv > 0) {
+        std::cout << "deposit;firstX;firstY;firstZ;sourceDirX;sourceDirY;sourceDirZ;numScatters;track;thread;history" << std::endl;
+    }
+
+    std::vector<ListModeRecord> chunk (1 << 16);
+    unsigned long long numRecords = 0;
+    unsigned long long numAnnihilation = 0;
+    double totalDeposit = 0.0;
+    std::map<std::uint16_t, unsigned long long> scatterCounts;
+    while (file) {
+        file.read (reinterpret_cast<char*> (chunk.data ()), chunk.size () * sizeof (ListModeRecord));
+        const size_t count = file.gcount () / sizeof (ListModeRecord);
+        for (size_t i = 0; i < count; ++i) {
+            const ListModeRecord& r = chunk[i];
+            if (numRecords < numCsv) {
+                std::cout << r.deposit << ";" << r.firstX << ";" << r.firstY << ";" << r.firstZ << ";" << r.sourceDirX << ";" << r.sourceDirY << ";" << r.sourceDirZ << ";" << r.numScatters << ";" << r.track << ";" << r.thread << ";" << r.history << "\n";
+            }
+            numRecords++;
+            numAnnihilation += r.track == annihilationTrack;
+            totalDeposit += r.deposit;
+            scatterCounts[r.numScatters]++;
+        }
+    }
+
+    std::cout << "records: " << numRecords << std::endl;
+    std::cout << "annihilation photon records: " << numAnnihilation << std::endl;
+    std::cout << "mean deposit (MeV): " << (numRecords > 0 ? totalDeposit / numRecords : 0.0) << std::endl;
+    std::cout << "records by number of scatters:" << std::endl;
+    for (const auto& [numScatters, count] : scatterCounts) {
+        std::cout << "  " << numScatters << ": " << count << std::endl;
+    }
+}
@@ -1,7 +1,9 @@
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <random>
 #include "utility.hpp"
@@ -53,9 +55,8 @@ std::vector<coordinate> linspace3D (const coordinate start, const coordinate end
     return result;
 }
 
-std::map<float, int> CreateHistogram( std::vector<float>& data, double min, double max, int num_bins)
+static void AddToHistogram (std::map<float, int>& histogram, const std::vector<float>& data, double min, double max, int num_bins)
 {
-    std::map<float, int> histogram;
     double bin_width = (max - min) / num_bins;
 
     for (const auto& value : data) {
@@ -68,10 +69,55 @@ std::map<float, int> CreateHistogram( std::vector<float>& data, double min, doub
             histogram[bin_start]++;
         }
     }
+}
+
+std::map<float, int> CreateHistogram( std::vector<float>& data, double min, double max, int num_bins)
+{
+    std::map<float, int> histogram;
+    AddToHistogram (histogram, data, min, max, num_bins);
+    return histogram;
+}
 
+std::map<float, int> CreateHistogram (const std::vector<std::vector<float>>& data, double min, double max, int num_bins)
+{
+    std::map<float, int> histogram;
+    for (const auto& part : data) {
+        AddToHistogram (histogram, part, min, max, num_bins);
+    }
     return histogram;
 }
 
+static void AddToBins (const std::vector<float>& data, double min, double max, std::uint64_t* bins, size_t num_bins)
+{
+    const double bin_width = (max - min) / num_bins;
+
+    for (const auto& value : data) {
+        if (value >= min && value <= max) {
+            size_t bin_index = static_cast<size_t>((value - min) / bin_width);
+            if (bin_index >= num_bins) {
+                bin_index = num_bins - 1;
+            }
+            bins[bin_index]++;
+        }
+    }
+}
+
+void FillHistogram (const std::vector<float>& data, double min, double max, std::uint64_t* bins, size_t num_bins)
+{
+    std::fill (bins, bins + num_bins, 0);
+    if (num_bins == 0) return;
+    AddToBins (data, min, max, bins, num_bins);
+}
+
+void FillHistogram (const std::vector<std::vector<float>>& data, double min, double max, std::uint64_t* bins, size_t num_bins)
+{
+    std::fill (bins, bins + num_bins, 0);
+    if (num_bins == 0) return;
+    for (const auto& part : data) {
+        AddToBins (part, min, max, bins, num_bins);
+    }
+}
+
 void WriteHistogramToFile( std::map<float, int>& histogram, const std::string& filename)
 {
     std::ofstream file(filename);
@@ -79,6 +125,7 @@ void WriteHistogramToFile( std::map<float, int>& histogram, const std::string& f
         std::cerr << "Error: Could not open file " << filename << std::endl;
         return;
     }
+    file.precision (std::numeric_limits<float>::max_digits10); // bin starts read back exactly
 
     for (const auto& [bin_start, count] : histogram) {
         file << bin_start << ";" << count << "\n";
@@ -87,25 +134,142 @@ void WriteHistogramToFile( std::map<float, int>& histogram, const std::string& f
     file.close();
 }
 
-float GetStatisticalUncertainty (const std::vector<float>& data)
+void ApplyFWHM (std::vector<float>& data, float fwhm)
 {
-    const auto mean = std::accumulate(data.begin (), data.end (), 0.0f) / data.size ();
-    const auto meanSquare = std::accumulate(data.begin (), data.end (), 0.0f, [] (float sum, float value) {
-        return sum + value * value;
-    }) / data.size ();
-    const auto variance = meanSquare - mean * mean;
-    return variance;
+    std::random_device rd;
+    ApplyFWHM (data, fwhm, rd ());
 }
 
-void ApplyFWHM (std::vector<float>& data, float fwhm)
+void ApplyFWHM (std::vector<float>& data, float fwhm, unsigned int seed)
 {
     const auto sigma = fwhm / 2.3548;
     const auto mean = 0;// std::accumulate(data.begin (), data.end (), 0.0f) / data.size ();
-    std::random_device rd;
-    std::mt19937 gen (rd ());
+    std::mt19937 gen (seed);
     std::normal_distribution<> dist (mean, sigma);
 
     for (auto& value : data) {
         value += dist (gen);
     }
+}
+
+void ApplyFWHM (std::vector<std::vector<float>>& data, float fwhm)
+{
+    std::random_device rd;
+    ApplyFWHM (data, fwhm, rd ());
+}
+
+void ApplyFWHM (std::vector<std::vector<float>>& data, float fwhm, unsigned int seed)
+{
+    const auto sigma = fwhm / 2.3548;
+    std::mt19937 gen (seed);
+    std::normal_distribution<> dist (0.0, sigma);
+
+    // one generator across the parts, the same numbers as for the concatenated vector
+    for (auto& part : data) {
+        for (auto& value : part) {
+            value += dist (gen);
+        }
+    }
+}
+
+std::map<float, int> ReadHistogramFromFile (const std::string& filename)
+{
+    std::map<float, int> histogram;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return histogram;
+    }
+
+    float bin_start = 0.0f;
+    char separator = ';';
+    int count = 0;
+    while (file >> bin_start >> separator >> count) {
+        histogram[bin_start] = count;
+    }
+
+    return histogram;
+}
+
+// Two-sample chi-square over the union of bins, bins empty in both are skipped.
+// The p-value uses the Wilson-Hilferty normal approximation.
+ChiSquareResult CompareHistograms (const std::map<float, int>& first, const std::map<float, int>& second)
+{
+    double sumFirst = 0.0;
+    double sumSecond = 0.0;
+    for (const auto& [bin_start, count] : first) {
+        sumFirst += count;
+    }
+    for (const auto& [bin_start, count] : second) {
+        sumSecond += count;
+    }
+    if (sumFirst == 0.0 || sumSecond == 0.0) {
+        return {0.0, 0, 1.0};
+    }
+
+    const double k1 = std::sqrt (sumSecond / sumFirst);
+    const double k2 = std::sqrt (sumFirst / sumSecond);
+
+    std::map<float, std::pair<int, int>> merged;
+    for (const auto& [bin_start, count] : first) {
+        merged[bin_start].first = count;
+    }
+    for (const auto& [bin_start, count] : second) {
+        merged[bin_start].second = count;
+    }
+
+    double chiSquare = 0.0;
+    int bins = 0;
+    for (const auto& [bin_start, counts] : merged) {
+        const double total = counts.first + counts.second;
+        if (total == 0.0) continue;
+        const double diff = k1 * counts.first - k2 * counts.second;
+        chiSquare += diff * diff / total;
+        bins++;
+    }
+
+    const int dof = bins > 1 ? bins - 1 : 1;
+    const double h = 2.0 / (9.0 * dof);
+    const double z = (std::cbrt (chiSquare / dof) - (1.0 - h)) / std::sqrt (h);
+    const double pValue = 0.5 * std::erfc (z / std::sqrt (2.0));
+    return {chiSquare, dof, pValue};
+}
+
+KolmogorovSmirnovResult CompareHistogramsKS (const std::map<float, int>& first, const std::map<float, int>& second)
+{
+    double sumFirst = 0.0;
+    double sumSecond = 0.0;
+    std::map<float, std::pair<int, int>> merged;
+    for (const auto& [bin_start, count] : first) {
+        merged[bin_start].first = count;
+        sumFirst += count;
+    }
+    for (const auto& [bin_start, count] : second) {
+        merged[bin_start].second = count;
+        sumSecond += count;
+    }
+    if (sumFirst == 0.0 || sumSecond == 0.0) {
+        return {0.0, 1.0};
+    }
+
+    double cumulativeFirst = 0.0;
+    double cumulativeSecond = 0.0;
+    double statistic = 0.0;
+    for (const auto& [bin_start, counts] : merged) {
+        cumulativeFirst += counts.first / sumFirst;
+        cumulativeSecond += counts.second / sumSecond;
+        statistic = std::max (statistic, std::abs (cumulativeFirst - cumulativeSecond));
+    }
+
+    // asymptotic Kolmogorov distribution with the usual small-sample correction
+    const double ne = std::sqrt (sumFirst * sumSecond / (sumFirst + sumSecond));
+    const double lambda = (ne + 0.12 + 0.11 / ne) * statistic;
+    double pValue = 0.0;
+    for (int j = 1; j <= 100; ++j) {
+        const double term = 2.0 * ((j % 2) ? 1.0 : -1.0) * std::exp (-2.0 * j * j * lambda * lambda);
+        pValue += term;
+        if (std::abs (term) < 1e-12) break;
+    }
+    if (lambda < 0.2) pValue = 1.0; // the series does not converge there, the distributions agree
+    return {statistic, std::clamp (pValue, 0.0, 1.0)};
 }
\ No newline at end of file
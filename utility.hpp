@@ -1,3 +1,5 @@
+#pragma once
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <string>
@@ -8,9 +10,31 @@ struct coordinate {
     float z;
 };
 
+struct ChiSquareResult {
+    double chiSquare;
+    int degreesOfFreedom;
+    double pValue;
+};
+
+struct KolmogorovSmirnovResult {
+    double statistic; // largest distance of the two normalized cumulative histograms
+    double pValue;
+};
+
 void ApplyFWHM (std::vector<float>& data, float fwhm);
-float GetStatisticalUncertainty (const std::vector<float>& data);
+void ApplyFWHM (std::vector<float>& data, float fwhm, unsigned int seed);
+// Per-thread results, treated as one vector in thread order
+void ApplyFWHM (std::vector<std::vector<float>>& data, float fwhm);
+void ApplyFWHM (std::vector<std::vector<float>>& data, float fwhm, unsigned int seed);
 std::vector<float> linspace (double start, double end, size_t num_points);
 std::vector<coordinate> linspace3D (const coordinate start, const coordinate end, const size_t num_points);
 std::map<float, int> CreateHistogram( std::vector<float>& data, double min, double max, int num_bins);
-void WriteHistogramToFile( std::map<float, int>& histogram, const std::string& filename);
\ No newline at end of file
+std::map<float, int> CreateHistogram (const std::vector<std::vector<float>>& data, double min, double max, int num_bins);
+void WriteHistogramToFile( std::map<float, int>& histogram, const std::string& filename);
+// Bins straight into a caller-owned array of num_bins counts, values outside [min, max] are dropped
+void FillHistogram (const std::vector<float>& data, double min, double max, std::uint64_t* bins, size_t num_bins);
+void FillHistogram (const std::vector<std::vector<float>>& data, double min, double max, std::uint64_t* bins, size_t num_bins);
+std::map<float, int> ReadHistogramFromFile (const std::string& filename);
+ChiSquareResult CompareHistograms (const std::map<float, int>& first, const std::map<float, int>& second);
+// Two-sample KS on binned data, conservative since ties inside a bin are not resolved
+KolmogorovSmirnovResult CompareHistogramsKS (const std::map<float, int>& first, const std::map<float, int>& second);
\ No newline at end of file
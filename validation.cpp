@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include "validation.hpp"
+#include "simulation.hpp"
+#include "utility.hpp"
+
+
+struct ScenarioResult {
+    std::uint32_t seed;
+    long long numPhotons;
+    EfficiencyEstimate efficiencies;
+    double photonsPerSecond;
+    std::map<float, int> histogram;
+};
+
+
+std::vector<ReferenceScenario> GetReferenceScenarios ()
+{
+    return {
+        {"cs137", {3.0f, -3.0f, 2.0f}, 0.6617f, 2.5f, 3.0f, 6.0f / 1000.0f},
+        {"co60", {4.0f, 4.0f, 0.0f}, 1.3325f, 3.0f, 5.0f, 8.0f / 1000.0f}
+    };
+}
+
+static ScenarioResult RunScenario (const ReferenceScenario& scenario, const ValidationOptions& options, const std::map<float, InteractionData>& crossSections, const bool measureSpeed)
+{
+    ThreadingConfig threading;
+    threading.numThreads = options.numThreads;
+    const std::uint32_t seed = options.writeReferences ? options.referenceSeed : options.seed;
+    TransportResult transport = RunTransport (0, static_cast<int> (options.numPhotons), scenario.source, crossSections,
+                                              scenario.E, scenario.R, scenario.H, threading, seed, false, nullptr);
+
+    ScenarioResult result;
+    result.seed = seed;
+    result.numPhotons = options.numPhotons;
+    result.efficiencies = ComputeEfficiencies (transport);
+    long long bestMs = transport.transportMs;
+    for (int i = 1; measureSpeed && i < options.speedRepeats; ++i) {
+        const TransportResult repeat = RunTransport (0, static_cast<int> (options.numPhotons), scenario.source, crossSections,
+                                                     scenario.E, scenario.R, scenario.H, threading, seed, false, nullptr);
+        bestMs = std::min (bestMs, repeat.transportMs);
+    }
+    result.photonsPerSecond = options.numPhotons * 1000.0 / std::max (1LL, bestMs);
+    ApplyFWHM (transport.results, scenario.FWHM, seed + 1);
+    result.histogram = CreateHistogram (transport.results, 0.0f, scenario.E + 0.1 * scenario.E, 1024);
+    return result;
+}
+
+static void WriteReference (const std::filesystem::path& base, const ScenarioResult& result)
+{
+    std::filesystem::create_directories (base.parent_path ());
+    std::ofstream file (base.string () + ".txt");
+    file.precision (9);
+    file << "seed " << result.seed << "\n";
+    file << "numPhotons " << result.numPhotons << "\n";
+    file << "totalEfficiency " << result.efficiencies.totalEfficiency << " " << result.efficiencies.totalError << "\n";
+    file << "interactionEfficiency " << result.efficiencies.interactionEfficiency << " " << result.efficiencies.interactionError << "\n";
+    std::map<float, int> histogram = result.histogram;
+    WriteHistogramToFile (histogram, base.string () + "_histogram.csv");
+}
+
+static bool ReadReference (const std::filesystem::path& base, ScenarioResult& reference)
+{
+    std::ifstream file (base.string () + ".txt");
+    if (!file.is_open ()) {
+        std::cerr << "Error: Could not open file " << base.string () << ".txt" << std::endl;
+        return false;
+    }
+    reference.seed = 0;
+    reference.efficiencies = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    std::string key;
+    while (file >> key) {
+        if (key == "seed") {
+            file >> reference.seed;
+        } else if (key == "numPhotons") {
+            file >> reference.numPhotons;
+        } else if (key == "totalEfficiency") {
+            file >> reference.efficiencies.totalEfficiency >> reference.efficiencies.totalError;
+        } else if (key == "interactionEfficiency") {
+            file >> reference.efficiencies.interactionEfficiency >> reference.efficiencies.interactionError;
+        }
+    }
+    reference.histogram = ReadHistogramFromFile (base.string () + "_histogram.csv");
+    return !reference.histogram.empty ();
+}
+
+// Speed depends on the machine, so the baseline lives next to the references under the host name
+static std::filesystem::path SpeedBaselinePath (const ValidationOptions& options)
+{
+    std::string host = "localhost";
+    char name[256] = {};
+    if (gethostname (name, sizeof (name) - 1) == 0 && name[0] != '\0') {
+        host = name;
+    }
+    return std::filesystem::path (options.referenceDir) / ("speed-" + host + ".txt");
+}
+
+// photons/s per scenario name, empty when there is no baseline for this host
+static std::map<std::string, double> ReadSpeedBaseline (const std::filesystem::path& path)
+{
+    std::map<std::string, double> baseline;
+    std::ifstream file (path);
+    std::string name;
+    double photonsPerSecond;
+    while (file >> name >> photonsPerSecond) {
+        baseline[name] = photonsPerSecond;
+    }
+    return baseline;
+}
+
+// Difference of two estimates in units of their combined standard error
+static double Sigmas (const double a, const double errA, const double b, const double errB)
+{
+    const double err = std::sqrt (errA * errA + errB * errB);
+    return err > 0.0 ? std::abs (a - b) / err : (a == b ? 0.0 : INFINITY);
+}
+
+int RunValidation (const ValidationOptions& options, const std::map<float, InteractionData>& crossSections)
+{
+    const std::filesystem::path speedPath = SpeedBaselinePath (options);
+    const std::map<std::string, double> speedBaseline = options.writeSpeedBaseline ? std::map<std::string, double> () : ReadSpeedBaseline (speedPath);
+    std::map<std::string, double> newSpeedBaseline;
+
+    int failures = 0;
+    for (const auto& scenario : GetReferenceScenarios ()) {
+        const std::filesystem::path base = std::filesystem::path (options.referenceDir) / scenario.name;
+        const auto baselineSpeed = speedBaseline.find (scenario.name);
+        const bool checkSpeed = !options.writeReferences && !options.writeSpeedBaseline && baselineSpeed != speedBaseline.end ();
+        const ScenarioResult result = RunScenario (scenario, options, crossSections, checkSpeed || options.writeSpeedBaseline);
+
+        std::cout << "----------------------------------------------------------------------" << std::endl;
+        std::cout << scenario.name << ": " << scenario.E << " MeV, " << options.numPhotons << " photons, seed " << result.seed << std::endl;
+        std::cout << "photons/s: " << result.photonsPerSecond << std::endl;
+        std::cout << "total efficiency: " << result.efficiencies.totalEfficiency << " +- " << result.efficiencies.totalError << "%" << std::endl;
+        std::cout << "interaction efficiency: " << result.efficiencies.interactionEfficiency << " +- " << result.efficiencies.interactionError << "%" << std::endl;
+
+        if (options.writeSpeedBaseline) {
+            newSpeedBaseline[scenario.name] = result.photonsPerSecond;
+        }
+        if (options.writeReferences) {
+            WriteReference (base, result);
+            std::cout << "reference written to " << base.string () << ".txt" << std::endl;
+        }
+        if (options.writeReferences || options.writeSpeedBaseline) {
+            continue;
+        }
+
+        ScenarioResult reference;
+        if (!ReadReference (base, reference)) {
+            std::cout << "FAILED: no reference, create one with --write-references" << std::endl;
+            failures++;
+            continue;
+        }
+        if (reference.seed == result.seed) {
+            // the same random numbers on both sides, the tests below would pass trivially
+            std::cout << "FAILED: reference made with the check seed " << result.seed << ", the samples are not independent" << std::endl;
+            failures++;
+            continue;
+        }
+
+        const double totalSigmas = Sigmas (result.efficiencies.totalEfficiency, result.efficiencies.totalError,
+                                           reference.efficiencies.totalEfficiency, reference.efficiencies.totalError);
+        const double interactionSigmas = Sigmas (result.efficiencies.interactionEfficiency, result.efficiencies.interactionError,
+                                                 reference.efficiencies.interactionEfficiency, reference.efficiencies.interactionError);
+        const ChiSquareResult chiSquare = CompareHistograms (result.histogram, reference.histogram);
+        const KolmogorovSmirnovResult ks = CompareHistogramsKS (result.histogram, reference.histogram);
+
+        std::cout << "total efficiency vs reference: " << totalSigmas << " sigma" << std::endl;
+        std::cout << "interaction efficiency vs reference: " << interactionSigmas << " sigma" << std::endl;
+        std::cout << "spectrum chi2/dof: " << chiSquare.chiSquare << "/" << chiSquare.degreesOfFreedom << " p = " << chiSquare.pValue << std::endl;
+        std::cout << "spectrum KS: D = " << ks.statistic << " p = " << ks.pValue << std::endl;
+
+        bool fastEnough = true;
+        if (checkSpeed) {
+            const double speedRatio = result.photonsPerSecond / baselineSpeed->second;
+            std::cout << "speed vs baseline of this host: " << speedRatio << "x" << std::endl;
+            fastEnough = speedRatio >= 1.0 - options.speedTolerance;
+        } else {
+            std::cout << "speed: no baseline for this host in " << speedPath.string () << ", skipped (make speed-baseline)" << std::endl;
+        }
+
+        const bool statisticallyIdentical = totalSigmas <= options.maxSigma && interactionSigmas <= options.maxSigma &&
+                                            chiSquare.pValue >= options.pValueThreshold && ks.pValue >= options.pValueThreshold;
+        if (!statisticallyIdentical) {
+            std::cout << "FAILED: results differ from the reference" << std::endl;
+        }
+        if (!fastEnough) {
+            std::cout << "FAILED: slower than the baseline" << std::endl;
+        }
+        if (statisticallyIdentical && fastEnough) {
+            std::cout << "passed" << std::endl;
+        } else {
+            failures++;
+        }
+    }
+
+    if (options.writeSpeedBaseline) {
+        std::filesystem::create_directories (speedPath.parent_path ());
+        std::ofstream file (speedPath);
+        if (!file.is_open ()) {
+            std::cerr << "Error: Could not open file " << speedPath.string () << std::endl;
+            return 1;
+        }
+        file.precision (9);
+        for (const auto& [name, photonsPerSecond] : newSpeedBaseline) {
+            file << name << " " << photonsPerSecond << "\n";
+        }
+        std::cout << "speed baseline written to " << speedPath.string () << std::endl;
+    }
+    return failures;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "crosssections.hpp"
+#include "geometry.hpp"
+
+
+// Fixed configurations checked against stored references
+struct ReferenceScenario {
+    std::string name;
+    Vector source;
+    float E; // MeV
+    float R; // cm
+    float H; // cm
+    float FWHM; // MeV
+};
+
+struct ValidationOptions {
+    long long numPhotons = 8000000; // references and checks, a 1% transport bias shows as ~9 sigma
+    unsigned int numThreads = 4; // fixed, the thread seeds depend on it
+    // Different seeds, so the checked run is statistically independent of the references. They are
+    // fixed only to make a validation run reproducible.
+    std::uint32_t referenceSeed = 20240611; // --write-references
+    std::uint32_t seed = 20240612;
+    std::string referenceDir = "validation";
+    bool writeReferences = false;
+    bool writeSpeedBaseline = false; // photons/s of this build on this host, kept out of git
+    double pValueThreshold = 0.001; // chi-square and KS
+    double maxSigma = 4.0; // efficiency difference in combined standard errors
+    double speedTolerance = 0.25; // fail when photons/s drops more than this fraction below the baseline
+    int speedRepeats = 3; // photons/s is the best of this many transports
+};
+
+// The 0.6617 MeV and 1.3325 MeV setups of the commented mains in main.cpp
+std::vector<ReferenceScenario> GetReferenceScenarios ();
+
+// Runs every reference scenario and compares efficiencies and spectrum with the stored references,
+// and photons/s with the speed baseline of this host when there is one. Writes new references or
+// a new baseline instead when asked. Returns the number of failed scenarios.
+int RunValidation (const ValidationOptions& options, const std::map<float, InteractionData>& crossSections);